@@ -0,0 +1,291 @@
+// SPDX-FileCopyrightText: Copyright 2021-2025 xiota
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <sys/resource.h>
+
+#include <CLI/CLI.hpp>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "model_script.h"
+#include "renderers_fdx.h"
+#include "renderers_html.h"
+#include "renderers_screenplain.h"
+#include "renderers_textplay.h"
+#include "renderers_xml.h"
+#include "utils_scan.h"
+
+#ifdef HAVE_PODOFO
+#  include "renderers_pdf.h"
+#endif
+
+namespace {
+
+// Pseudo-random numbers that are the same on every platform, so each size always
+// generates the same script.
+class Random {
+ public:
+  explicit Random(const std::uint64_t seed) : state(seed) {}
+
+  std::size_t below(const std::size_t n) {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    return (state >> 33) % n;
+  }
+  bool percent(const std::size_t p) { return below(100) < p; }
+
+  template <std::size_t N>
+  const char *pick(const char *const (&list)[N]) {
+    return list[below(N)];
+  }
+
+ private:
+  std::uint64_t state;
+};
+
+constexpr const char *words[] = {
+  "the",    "a",      "door",   "light",  "slowly", "window", "she",    "he",
+  "looks",  "away",   "rain",   "across", "street", "phone",  "rings",  "quiet",
+  "letter", "hands",  "table",  "never",  "always", "back",   "through", "again",
+  "corner", "shadow", "coffee", "waits",  "turns",  "night",  "under",  "finally",
+};
+constexpr const char *names[] = { "ALICE", "BOB",     "CAROL", "DETECTIVE RAMOS",
+                                  "EVE",   "MALLORY", "TRENT", "MRS. PEREZ" };
+constexpr const char *places[] = { "KITCHEN", "POLICE STATION", "ROOFTOP", "DINER",
+                                   "CAR",     "HOSPITAL HALLWAY", "PARK",  "APARTMENT" };
+constexpr const char *times[] = { "DAY", "NIGHT", "MORNING", "LATER", "CONTINUOUS" };
+constexpr const char *transitions[] = { "CUT TO:", "DISSOLVE TO:", "SMASH CUT TO:" };
+constexpr const char *asides[] = { "(beat)", "(quietly)", "(into phone)", "(V.O.)" };
+
+// Typical screenplay page length, in lines
+constexpr std::size_t lines_per_page = 55;
+
+// Words with occasional emphasis
+std::string sentence(Random &random, std::size_t count) {
+  std::string output;
+  while (count-- > 0) {
+    const std::string word = random.pick(words);
+    if (!output.empty()) {
+      output += ' ';
+    }
+    switch (random.below(40)) {
+      case 0:
+        output += '*' + word + '*';
+        break;
+      case 1:
+        output += "**" + word + "**";
+        break;
+      case 2:
+        output += '_' + word + '_';
+        break;
+      case 3:
+        output += "***" + word + "***";
+        break;
+      default:
+        output += word;
+        break;
+    }
+  }
+  output += '.';
+  output[0] = std::toupper(static_cast<unsigned char>(output[0]));
+  return output;
+}
+
+// Appends a character cue with one to three lines of speech.
+void dialog(Random &random, std::string &output, const bool &dual) {
+  output += random.pick(names);
+  output += dual ? " ^\n" : "\n";
+  if (random.percent(25)) {
+    output += std::string(random.pick(asides)) + '\n';
+  }
+  for (std::size_t line = 0, count = 1 + random.below(3); line < count; ++line) {
+    if (random.percent(5)) {
+      output += "~" + sentence(random, 3 + random.below(4)) + '\n';
+    } else {
+      output += sentence(random, 4 + random.below(10)) + '\n';
+    }
+  }
+  output += '\n';
+}
+
+// A script of about the given number of pages, with a title page, sections, notes and
+// boneyard among scenes of action and dialog.
+std::string generateScript(const std::size_t pages) {
+  Random random(pages);
+  std::string output =
+      "Title: Benchmark\nCredit: Written by\nAuthor: Generator\nDraft date: 1/1/2025\n\n";
+
+  const std::size_t target = pages * lines_per_page;
+  std::size_t lines = 0;
+  for (std::size_t scene = 1; lines < target; ++scene) {
+    const std::size_t start = output.length();
+    if (scene % 20 == 1) {
+      output += "# Act " + std::to_string(scene / 20 + 1) + "\n\n";
+      output += "= " + sentence(random, 8) + "\n\n";
+    }
+    output += (random.percent(50) ? "INT. " : "EXT. ") + std::string(random.pick(places)) +
+              " - " + random.pick(times);
+    if (random.percent(20)) {
+      output += " #" + std::to_string(scene) + "#";
+    }
+    output += "\n\n";
+
+    for (std::size_t beat = 0, count = 3 + random.below(6); beat < count; ++beat) {
+      const std::size_t kind = random.below(100);
+      if (kind < 35) {
+        for (std::size_t line = 0, length = 1 + random.below(4); line < length; ++line) {
+          output += sentence(random, 6 + random.below(10));
+          if (random.percent(10)) {
+            output += " [[" + sentence(random, 4) + "]]";
+          }
+          output += '\n';
+        }
+        output += '\n';
+      } else if (kind < 80) {
+        dialog(random, output, false);
+      } else if (kind < 88) {
+        dialog(random, output, false);
+        dialog(random, output, true);
+      } else if (kind < 93) {
+        output += "/*\n" + sentence(random, 12) + '\n' + sentence(random, 8) + "\n*/\n\n";
+      } else if (kind < 96) {
+        output += "> " + sentence(random, 3) + " <\n\n";
+      } else {
+        output += "[[" + sentence(random, 10) + "]]\n\n";
+      }
+    }
+
+    if (random.percent(30)) {
+      output += std::string(random.pick(transitions)) + "\n\n";
+    }
+    if (random.percent(3)) {
+      output += "===\n\n";
+    }
+    lines += std::count(output.begin() + start, output.end(), '\n');
+  }
+  output += "> THE END <\n";
+  return output;
+}
+
+// Peak resident set size of this process, in kilobytes
+long peakRss() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+// Shortest time of several runs of task, in seconds
+double bestTime(const unsigned &repeat, const std::function<void()> &task) {
+  double best = 0;
+  for (unsigned run = 0; run < std::max(1u, repeat); ++run) {
+    const auto start = std::chrono::steady_clock::now();
+    task();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (run == 0 || elapsed.count() < best) {
+      best = elapsed.count();
+    }
+  }
+  return best;
+}
+
+// One result per line, as JSON
+void report(
+    const std::string &name,
+    const std::size_t &pages,
+    const std::size_t &bytes,
+    const std::size_t &nodes,
+    const double &seconds,
+    const std::size_t &output_bytes = 0
+) {
+  char line[512];
+  std::snprintf(
+      line,
+      sizeof(line),
+      "{\"benchmark\": \"%s\", \"pages\": %zu, \"bytes\": %zu, \"nodes\": %zu, "
+      "\"output_bytes\": %zu, \"seconds\": %.6f, \"mb_per_s\": %.3f, \"nodes_per_s\": %.0f, "
+      "\"peak_rss_kb\": %ld, \"kernels\": \"%s\"}",
+      name.c_str(),
+      pages,
+      bytes,
+      nodes,
+      output_bytes,
+      seconds,
+      seconds > 0 ? bytes / seconds / 1e6 : 0.0,
+      seconds > 0 ? nodes / seconds : 0.0,
+      peakRss(),
+      scan_kernels()
+  );
+  std::cout << line << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  CLI::App app{ "Parse and render synthetic scripts, reporting throughput as JSON lines" };
+
+  std::vector<std::size_t> page_counts{ 1, 10, 100, 1000 };
+  app.add_option("-p, --pages", page_counts, "script sizes in pages")
+      ->option_text("<n>[,<n>...]")
+      ->delimiter(',');
+
+  unsigned repeat = 3;
+  app.add_option("-r, --repeat", repeat, "runs of each benchmark, the fastest is reported")
+      ->option_text("<n>");
+
+  bool emit = false;
+  app.add_flag("--emit", emit, "write the script for the first size to stdout and exit");
+
+  app.set_version_flag("-V, --version", "ftn2xml-benchmark " VERSION);
+
+  try {
+    app.parse(argc, argv);
+  } catch (const CLI::ParseError &e) {
+    return app.exit(e);
+  }
+
+  if (emit) {
+    std::cout << generateScript(page_counts.empty() ? 1 : page_counts.front());
+    return 0;
+  }
+
+  for (const std::size_t pages : page_counts) {
+    const std::string text = generateScript(pages);
+
+    Fountain::Script script;
+    double seconds = bestTime(repeat, [&]() { script.parseFountain(text); });
+    const std::size_t nodes = script.nodes.size();
+    report("parse", pages, text.length(), nodes, seconds);
+
+    // renderers are timed from the parsed script
+    const std::vector<std::pair<std::string, std::function<std::string()>>> renderers{
+      { "ftn2xml", [&]() { return Fountain::ftn2xml(script); } },
+      { "ftn2html", [&]() { return Fountain::ftn2html(script); } },
+      { "ftn2fdx", [&]() { return Fountain::ftn2fdx(script); } },
+      { "ftn2screenplain", [&]() { return Fountain::ftn2screenplain(script); } },
+      { "ftn2textplay", [&]() { return Fountain::ftn2textplay(script); } },
+    };
+    for (const auto &[name, render] : renderers) {
+      std::size_t length = 0;
+      seconds = bestTime(repeat, [&]() { length = render().length(); });
+      report(name, pages, text.length(), nodes, seconds, length);
+    }
+
+#ifdef HAVE_PODOFO
+    const std::string pdf_file =
+        (std::filesystem::temp_directory_path() / "ftn2xml-benchmark.pdf").string();
+    seconds = bestTime(repeat, [&]() { Fountain::ftn2pdf(pdf_file, script); });
+    std::filesystem::remove(pdf_file);
+    report("ftn2pdf", pages, text.length(), nodes, seconds);
+#endif
+  }
+
+  return 0;
+}
@@ -2,24 +2,802 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include <CLI/CLI.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "config.h"
+#include "model_script.h"
+#include "parser_fountain.h"
 #include "renderers_fdx.h"
 #include "renderers_html.h"
+#include "renderers_markup.h"
 #include "renderers_screenplain.h"
 #include "renderers_textplay.h"
 #include "renderers_xml.h"
 #include "utils_file.h"
+#include "utils_stats.h"
 #include "utils_string.h"
 
 #ifdef HAVE_PODOFO
 #  include "renderers_pdf.h"
 #endif
 
+#ifdef __linux__
+#  include <poll.h>
+#  include <sys/inotify.h>
+#  include <unistd.h>
+#  define FOUNTAIN_HAVE_INOTIFY
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <sys/socket.h>
+#  include <sys/un.h>
+#  include <unistd.h>
+#  define FOUNTAIN_HAVE_SERVER
+#endif
+
+namespace {
+
+// An output format with its stylesheet and file extension
+struct Target {
+  std::string type;
+  std::string css;
+  std::string extension;
+};
+
+// Writes script rendered as target.type to output, for every type but pdf.
+void renderStream(
+    std::ostream &output,
+    const Fountain::Script &script,
+    const Target &target,
+    const bool &css_embed
+) {
+  if (target.type == "ast") {
+    script.save(output);
+  } else if (target.type == "html") {
+    Fountain::ftn2html(output, script, target.css, css_embed);
+  } else if (target.type == "fdx") {
+    Fountain::ftn2fdx(output, script);
+  } else if (target.type == "screenplain") {
+    Fountain::ftn2screenplain(output, script, target.css, css_embed);
+  } else if (target.type == "textplay") {
+    Fountain::ftn2textplay(output, script, target.css, css_embed);
+  } else {
+    // default: xml
+    Fountain::ftn2xml(output, script, target.css, css_embed);
+  }
+}
+
+// Writes script rendered as target.type into output_file.  Returns false if it cannot be
+// written.
+bool render(
+    const Fountain::Script &script,
+    const Target &target,
+    const std::string &output_file,
+    const bool &css_embed
+) {
+#ifdef HAVE_PODOFO
+  if (target.type == "pdf") {
+    return Fountain::ftn2pdf(output_file, script);
+  }
+#endif
+
+  // stream output as it is rendered
+  const auto mode = (target.type == "ast") ? std::ios::out | std::ios::binary : std::ios::out;
+  std::ofstream output(output_file, mode);
+  if (!output) {
+    return false;
+  }
+  renderStream(output, script, target, css_embed);
+  output.close();
+  return !output.fail();
+}
+
+// Loads a script saved with the ast type, or parses Fountain text.  Returns false if a saved
+// script is damaged.
+bool readScript(
+    const std::string_view &data,
+    const unsigned &threads,
+    Fountain::Script &script
+) {
+  if (Fountain::Script::isSaved(data)) {
+    return script.load(data);
+  }
+  script.parseFountain(data, threads);
+  return true;
+}
+
+// Renders one parsed script into each target, on separate threads if concurrent.  Returns an
+// error message, or an empty string if every output was written.
+std::string renderTargets(
+    const Fountain::Script &script,
+    const std::vector<Target> &targets,
+    const std::vector<std::string> &outputs,
+    const bool &css_embed,
+    const bool concurrent
+) {
+  std::vector<std::string> errors(targets.size());
+  auto task = [&](const std::size_t i) {
+    try {
+      if (!render(script, targets[i], outputs[i], css_embed)) {
+        errors[i] = "cannot write " + outputs[i];
+      }
+    } catch (const std::exception &e) {
+      errors[i] = outputs[i] + ": " + e.what();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i < targets.size(); ++i) {
+    if (concurrent) {
+      threads.emplace_back(task, i);
+    } else {
+      task(i);
+    }
+  }
+  if (!targets.empty()) {
+    task(0);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::string message;
+  for (const auto &error : errors) {
+    if (!error.empty()) {
+      message += message.empty() ? error : "; " + error;
+    }
+  }
+  return message;
+}
+
+// Copies a file in full.  Returns false if either file cannot be opened or written.
+bool copyFile(const std::string &from, const std::string &to) {
+  std::ifstream input(from, std::ios::in | std::ios::binary);
+  if (!input) {
+    return false;
+  }
+  std::ofstream output(to, std::ios::out | std::ios::binary);
+  if (input.peek() != std::ifstream::traits_type::eof()) {
+    output << input.rdbuf();
+  }
+  output.close();
+  return !output.fail();
+}
+
+// Name of the cached output for target.  It changes with the input, the options that affect
+// rendering, and the version, so a stale entry is never used.
+std::string cacheName(
+    const std::string &input_hash,
+    const Target &target,
+    const bool &css_embed
+) {
+  std::string options = VERSION "\n" + target.type + "\n" + target.css;
+  if (css_embed) {
+    options += "\nembed\n" + Fountain::stylesheet_contents(target.css);
+  }
+  char name[24];
+  std::snprintf(
+      name, sizeof(name), "-%016llx", static_cast<unsigned long long>(hash_bytes(options))
+  );
+  return input_hash + name + target.extension;
+}
+
+// Converts input into the output for each target, parsing with threads and rendering targets
+// concurrently if threads > 1.  With a cache directory, outputs rendered earlier for the same
+// input and options are copied from it, and the input is parsed only if some are missing.
+// Returns an error message, or an empty string on success.
+std::string convert(
+    const std::string_view &input,
+    const std::vector<Target> &targets,
+    const std::vector<std::string> &outputs,
+    const bool &css_embed,
+    const unsigned &threads,
+    const std::string &cache_dir
+) {
+  Fountain::Script script;
+  if (cache_dir.empty()) {
+    if (!readScript(input, threads, script)) {
+      return "damaged saved script";
+    }
+    return renderTargets(script, targets, outputs, css_embed, threads > 1);
+  }
+
+  char input_hash[48];
+  std::snprintf(
+      input_hash,
+      sizeof(input_hash),
+      "%016llx-%zu",
+      static_cast<unsigned long long>(hash_bytes(input)),
+      input.length()
+  );
+
+  // missing outputs are rendered into temporary files that are renamed when complete, so
+  // concurrent conversions never see a partial entry
+  std::vector<std::string> cached;
+  std::vector<std::size_t> missing;
+  std::vector<Target> missing_targets;
+  std::vector<std::string> temporary;
+  const auto unique = std::hash<std::thread::id>{}(std::this_thread::get_id()) ^
+                      std::chrono::steady_clock::now().time_since_epoch().count();
+  for (std::size_t i = 0; i < targets.size(); ++i) {
+    const std::string name = cacheName(input_hash, targets[i], css_embed);
+    cached.push_back((std::filesystem::path(cache_dir) / name).string());
+    std::error_code ec;
+    if (!std::filesystem::exists(cached[i], ec)) {
+      missing.push_back(i);
+      missing_targets.push_back(targets[i]);
+      temporary.push_back(cached[i] + ".tmp" + std::to_string(unique));
+    }
+  }
+
+  if (!missing.empty()) {
+    if (!readScript(input, threads, script)) {
+      return "damaged saved script";
+    }
+    const std::string error =
+        renderTargets(script, missing_targets, temporary, css_embed, threads > 1);
+    for (std::size_t j = 0; j < missing.size(); ++j) {
+      std::error_code ec;
+      if (error.empty()) {
+        std::filesystem::rename(temporary[j], cached[missing[j]], ec);
+      }
+      if (!error.empty() || ec) {
+        std::filesystem::remove(temporary[j], ec);
+      }
+    }
+    if (!error.empty()) {
+      return error;
+    }
+  }
+
+  std::string message;
+  for (std::size_t i = 0; i < targets.size(); ++i) {
+    if (!copyFile(cached[i], outputs[i])) {
+      message += (message.empty() ? "cannot write " : "; cannot write ") + outputs[i];
+    }
+  }
+  return message;
+}
+
+// Converts each input into out_dir, named after the input with the extension of each target,
+// using jobs threads and the cache directory if given.  Errors are reported per file in input
+// order.  Returns false if any failed.
+bool convertBatch(
+    const std::vector<std::string> &inputs,
+    const std::string &out_dir,
+    unsigned jobs,
+    const std::vector<Target> &targets,
+    const bool &css_embed,
+    const std::string &cache_dir
+) {
+  std::error_code ec;
+  std::filesystem::create_directories(out_dir, ec);
+
+  std::vector<std::vector<std::string>> outputs(inputs.size());
+  std::vector<std::string> errors(inputs.size());
+  std::map<std::string, std::size_t> claimed;
+  for (std::size_t i = 0; i < inputs.size(); ++i) {
+    for (const auto &target : targets) {
+      std::filesystem::path output = std::filesystem::path(inputs[i]).filename();
+      output.replace_extension(target.extension);
+      outputs[i].push_back((std::filesystem::path(out_dir) / output).string());
+      auto [it, added] = claimed.emplace(outputs[i].back(), i);
+      if (!added && it->second != i) {
+        errors[i] =
+            "output " + outputs[i].back() + " is also written for " + inputs[it->second];
+      }
+    }
+  }
+
+  // largest files first, so no thread is left with a long conversion at the end
+  std::vector<std::pair<std::uintmax_t, std::size_t>> order;
+  for (std::size_t i = 0; i < inputs.size(); ++i) {
+    const std::uintmax_t size = std::filesystem::file_size(inputs[i], ec);
+    order.emplace_back(ec ? 0 : size, i);
+  }
+  std::stable_sort(order.begin(), order.end(), [](const auto &a, const auto &b) {
+    return a.first > b.first;
+  });
+
+  // idle threads claim the next file from the shared queue
+  std::atomic<std::size_t> next{ 0 };
+  auto worker = [&]() {
+    for (std::size_t pos; (pos = next++) < order.size();) {
+      const std::size_t i = order[pos].second;
+      if (!errors[i].empty()) {
+        continue;
+      }
+      try {
+        const FileView input(inputs[i]);
+        if (!input.is_open()) {
+          errors[i] = "cannot read input";
+          continue;
+        }
+        errors[i] = convert(input.view(), targets, outputs[i], css_embed, 1, cache_dir);
+      } catch (const std::exception &e) {
+        errors[i] = e.what();
+      }
+    }
+  };
+
+  if (jobs == 0) {
+    jobs = std::max(1u, std::thread::hardware_concurrency());
+  }
+  jobs = std::min<std::size_t>(jobs, std::max<std::size_t>(inputs.size(), 1));
+  std::vector<std::thread> threads;
+  for (unsigned j = 1; j < jobs; ++j) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  bool success = true;
+  for (std::size_t i = 0; i < inputs.size(); ++i) {
+    if (!errors[i].empty()) {
+      std::cerr << "error: " << inputs[i] << ": " << errors[i] << std::endl;
+      success = false;
+    }
+  }
+  return success;
+}
+
+#ifdef FOUNTAIN_HAVE_INOTIFY
+// Quiet time that ends a burst of saves
+constexpr int watch_debounce_ms = 10;
+
+// Replaces file with contents through a rename, so readers never see a partial file.
+bool replaceFile(const std::string &file, const std::string &contents) {
+  const std::string temporary = file + ".tmp";
+  std::ofstream output(temporary, std::ios::out | std::ios::binary);
+  output.write(contents.data(), contents.length());
+  output.close();
+  std::error_code ec;
+  if (!output.fail()) {
+    std::filesystem::rename(temporary, file, ec);
+    if (!ec) {
+      return true;
+    }
+  }
+  std::filesystem::remove(temporary, ec);
+  return false;
+}
+
+// Renders input_file into outputs each time it is saved, until interrupted.  The script stays
+// parsed between saves, and only the paragraphs changed by a save are parsed again.  Outputs
+// are replaced only when their contents change.
+int watch(
+    const std::string &input_file,
+    const std::vector<Target> &targets,
+    const std::vector<std::string> &outputs,
+    const bool &css_embed,
+    const unsigned &threads
+) {
+  // watch the directory, since editors often save by replacing the file
+  const std::filesystem::path path(input_file);
+  const std::string name = path.filename().string();
+  const std::string dir = path.has_parent_path() ? path.parent_path().string() : ".";
+  const int fd = inotify_init1(IN_CLOEXEC);
+  if (fd < 0 || inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    std::cerr << "error: cannot watch " << dir << std::endl;
+    return 1;
+  }
+
+  Fountain::Script script;
+  std::string text;
+  bool parsed = false;
+  std::vector<std::string> rendered(targets.size());
+  for (;;) {
+    const FileView input(input_file);
+    if (input.is_open()) {
+      const std::string_view next = input.view();
+      if (!parsed || Fountain::Script::isSaved(next) || Fountain::Script::isSaved(text)) {
+        parsed = readScript(next, threads, script);
+      } else {
+        // re-parse only the text between the unchanged beginning and end
+        const std::size_t limit = std::min(text.length(), next.length());
+        std::size_t prefix = 0;
+        while (prefix < limit && text[prefix] == next[prefix]) {
+          ++prefix;
+        }
+        std::size_t suffix = 0;
+        while (suffix < limit - prefix &&
+               text[text.length() - 1 - suffix] == next[next.length() - 1 - suffix]) {
+          ++suffix;
+        }
+        script.applyEdit(
+            prefix,
+            text.length() - prefix - suffix,
+            std::string(next.substr(prefix, next.length() - prefix - suffix))
+        );
+      }
+      text.assign(next);
+
+      for (std::size_t i = 0; parsed && i < targets.size(); ++i) {
+        bool written = true;
+        if (targets[i].type == "pdf") {
+          std::error_code ec;
+          written = render(script, targets[i], outputs[i] + ".tmp", css_embed);
+          std::filesystem::rename(outputs[i] + ".tmp", outputs[i], ec);
+          written = written && !ec;
+        } else {
+          std::ostringstream output;
+          renderStream(output, script, targets[i], css_embed);
+          if (output.str() != rendered[i]) {
+            rendered[i] = output.str();
+            written = replaceFile(outputs[i], rendered[i]);
+          }
+        }
+        if (!written) {
+          std::cerr << "error: cannot write " << outputs[i] << std::endl;
+        }
+      }
+      if (!parsed) {
+        std::cerr << "error: damaged saved script" << std::endl;
+      }
+    }
+
+    // wait for the input to be saved, then for the burst of saves to end
+    alignas(inotify_event) char events[4096];
+    for (bool saved = false; !saved;) {
+      const ssize_t length = read(fd, events, sizeof(events));
+      if (length < 0 && errno != EINTR) {
+        close(fd);
+        return 1;
+      }
+      for (ssize_t pos = 0; pos < length;) {
+        const auto *event = reinterpret_cast<const inotify_event *>(events + pos);
+        saved = saved || (event->len && name == event->name);
+        pos += sizeof(inotify_event) + event->len;
+      }
+    }
+    pollfd pending{ fd, POLLIN, 0 };
+    while (poll(&pending, 1, watch_debounce_ms) > 0) {
+      if (read(fd, events, sizeof(events)) < 0 && errno != EINTR) {
+        break;
+      }
+    }
+  }
+}
+#endif
+
+#ifdef FOUNTAIN_HAVE_SERVER
+// Largest request the server accepts, in bytes
+constexpr std::uint32_t max_request = 1u << 30;
+
+// Reads exactly length bytes.  Returns false at end of input or on error.
+bool readAll(const int fd, char *data, std::size_t length) {
+  while (length > 0) {
+    const ssize_t count = read(fd, data, length);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      return false;
+    }
+    data += count;
+    length -= count;
+  }
+  return true;
+}
+
+bool writeAll(const int fd, const char *data, std::size_t length) {
+  while (length > 0) {
+    const ssize_t count = write(fd, data, length);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      return false;
+    }
+    data += count;
+    length -= count;
+  }
+  return true;
+}
+
+// A frame is a 4-byte big-endian length followed by that many bytes.
+bool readFrame(const int fd, std::string &payload) {
+  unsigned char header[4];
+  if (!readAll(fd, reinterpret_cast<char *>(header), sizeof(header))) {
+    return false;
+  }
+  const std::uint32_t length = std::uint32_t(header[0]) << 24 | std::uint32_t(header[1]) << 16 |
+                               std::uint32_t(header[2]) << 8 | header[3];
+  if (length > max_request) {
+    return false;
+  }
+  payload.resize(length);
+  return readAll(fd, payload.data(), length);
+}
+
+bool writeFrame(const int fd, const std::string &payload) {
+  const std::uint32_t length = payload.length();
+  const unsigned char header[4] = {
+    static_cast<unsigned char>(length >> 24),
+    static_cast<unsigned char>(length >> 16),
+    static_cast<unsigned char>(length >> 8),
+    static_cast<unsigned char>(length),
+  };
+  return writeAll(fd, reinterpret_cast<const char *>(header), sizeof(header)) &&
+         writeAll(fd, payload.data(), payload.length());
+}
+
+// Runs queued tasks on a fixed set of threads.  Queued tasks are finished before the pool is
+// destroyed.
+class WorkerPool {
+ public:
+  explicit WorkerPool(const unsigned &count) {
+    for (unsigned i = 0; i < std::max(1u, count); ++i) {
+      threads.emplace_back([this]() { work(); });
+    }
+  }
+  ~WorkerPool() {
+    {
+      const std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    ready.notify_all();
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  void run(std::function<void()> task) {
+    {
+      const std::lock_guard<std::mutex> lock(mutex);
+      tasks.push_back(std::move(task));
+    }
+    ready.notify_one();
+  }
+
+ private:
+  void work() {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this]() { return stopping || !tasks.empty(); });
+        if (tasks.empty()) {
+          return;
+        }
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque<std::function<void()>> tasks;
+  std::vector<std::thread> threads;
+  bool stopping = false;
+};
+
+// Defaults for options a request leaves out
+struct ServerDefaults {
+  std::string css_path;
+  std::map<std::string_view, std::string_view> css_list;
+  bool css_embed;
+};
+
+// Entry at position, counting from 1, or nullptr if there is none
+const Fountain::OutlineEntry *entryAt(
+    const std::vector<Fountain::OutlineEntry> &entries,
+    const std::string &position
+) {
+  if (position.empty() || position.find_first_not_of("0123456789") != std::string::npos) {
+    return nullptr;
+  }
+  const unsigned long n = std::strtoul(position.c_str(), nullptr, 10);
+  return (n >= 1 && n <= entries.size()) ? &entries[n - 1] : nullptr;
+}
+
+// Answers one request: lines of "name: value" options, a blank line, then the input.  The
+// options are type, css and embed (yes or no), and scene or section to render only part of
+// the input.  A scene is found by its #number#, or else by position, and a section by
+// position, counting from 1.  Type "stats" reports the counters of every request so far as
+// JSON.  The answer is "ok" or "error" on a line of its own, followed by the output or a
+// message.
+std::string answer(const std::string &request, const ServerDefaults &defaults) {
+  std::size_t body = request.find("\n\n");
+  body = (body == std::string::npos) ? request.length() : body + 2;
+  std::string type = "xml";
+  std::string css;
+  std::string scene;
+  std::string section;
+  bool css_embed = defaults.css_embed;
+  for (const auto &line : split_string(request.substr(0, body), "\n")) {
+    const std::size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+      continue;
+    }
+    const std::string name = ws_trim(line.substr(0, colon));
+    const std::string value = ws_trim(line.substr(colon + 1));
+    if (name == "type") {
+      type = value;
+    } else if (name == "css") {
+      css = value;
+    } else if (name == "embed") {
+      css_embed = (value == "yes");
+    } else if (name == "scene") {
+      scene = value;
+    } else if (name == "section") {
+      section = value;
+    }
+  }
+
+  if (type == "stats") {
+    return "ok\n" + Fountain::stats_report(true);
+  }
+  const auto default_css = defaults.css_list.find(type);
+  if (default_css == defaults.css_list.end()) {
+    return "error\nunknown type " + type;
+  }
+  if (css.empty()) {
+    css = defaults.css_path + "/" + std::string(default_css->second);
+  }
+  const Target target{ type, css, "" };
+
+  try {
+    Fountain::Script script;
+    if (!readScript(std::string_view(request).substr(body), 1, script)) {
+      return "error\ndamaged saved script";
+    }
+    if (!scene.empty() || !section.empty()) {
+      const Fountain::OutlineEntry *part = nullptr;
+      if (!scene.empty()) {
+        part = script.findScene(scene);
+        part = part ? part : entryAt(script.scenes, scene);
+      } else {
+        part = entryAt(script.sections, section);
+      }
+      if (!part) {
+        return "error\nno " + (scene.empty() ? "section " + section : "scene " + scene);
+      }
+      script = script.extract(part->node, part->end);
+    }
+    if (type == "pdf") {
+      // pdf is only written to files
+      const std::string unique =
+          std::to_string(getpid()) + "-" +
+          std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+      const std::filesystem::path temporary =
+          std::filesystem::temp_directory_path() / ("ftn2xml-serve-" + unique + ".pdf");
+      const bool written = render(script, target, temporary.string(), css_embed);
+      std::string output = file_get_contents(temporary.string());
+      std::error_code ec;
+      std::filesystem::remove(temporary, ec);
+      return written ? "ok\n" + output : "error\ncannot render pdf";
+    }
+    std::ostringstream output;
+    output << "ok\n";
+    renderStream(output, script, target, css_embed);
+    return output.str();
+  } catch (const std::exception &e) {
+    return std::string("error\n") + e.what();
+  }
+}
+
+// Answers framed requests with a pool of jobs threads, from stdin to stdout if endpoint is
+// "-", or else from clients of a Unix-domain socket at endpoint until interrupted.  On stdin,
+// requests are answered concurrently and in order.  A socket client may send requests one
+// after another on the same connection.
+int serve(const std::string &endpoint, const unsigned &jobs, const ServerDefaults &defaults) {
+  // a client that goes away must not end the server
+  std::signal(SIGPIPE, SIG_IGN);
+  WorkerPool pool(jobs);
+
+  if (endpoint == "-") {
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::future<std::string>> answers;
+    bool done = false;
+    std::thread writer([&]() {
+      for (;;) {
+        std::future<std::string> next;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          ready.wait(lock, [&]() { return done || !answers.empty(); });
+          if (answers.empty()) {
+            return;
+          }
+          next = std::move(answers.front());
+          answers.pop_front();
+        }
+        writeFrame(STDOUT_FILENO, next.get());
+      }
+    });
+
+    for (std::string request; readFrame(STDIN_FILENO, request);) {
+      auto task = std::make_shared<std::packaged_task<std::string()>>(
+          [request = std::move(request), &defaults]() { return answer(request, defaults); }
+      );
+      {
+        const std::lock_guard<std::mutex> lock(mutex);
+        answers.push_back(task->get_future());
+      }
+      ready.notify_one();
+      pool.run([task]() { (*task)(); });
+    }
+    {
+      const std::lock_guard<std::mutex> lock(mutex);
+      done = true;
+    }
+    ready.notify_one();
+    writer.join();
+    return 0;
+  }
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (endpoint.length() >= sizeof(address.sun_path)) {
+    std::cerr << "error: socket path is too long: " << endpoint << std::endl;
+    return 1;
+  }
+  std::memcpy(address.sun_path, endpoint.c_str(), endpoint.length() + 1);
+  const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(endpoint.c_str());
+  if (listener < 0 || bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) ||
+      listen(listener, SOMAXCONN)) {
+    std::cerr << "error: cannot listen on " << endpoint << std::endl;
+    return 1;
+  }
+  for (;;) {
+    const int client = accept(listener, nullptr, nullptr);
+    if (client < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      break;
+    }
+    pool.run([client, &defaults]() {
+      for (std::string request; readFrame(client, request);) {
+        if (!writeFrame(client, answer(request, defaults))) {
+          break;
+        }
+      }
+      close(client);
+    });
+  }
+  close(listener);
+  return 1;
+}
+#endif
+
+}  // namespace
+
 int main(int argc, char **argv) {
   auto cmd = std::string{ argv[0] };
   cmd = cmd.substr(cmd.find_last_of("/\\") + 1);
@@ -27,20 +805,41 @@ int main(int argc, char **argv) {
   CLI::App app;
 
   // input file
-  std::string input;
-  app.add_option("-i, --input", input, "input file, default: stdin")
+  std::string input_file;
+  app.add_option("-i, --input", input_file, "input file, default: stdin")
       ->option_text("<file>")
       ->default_val("/dev/stdin");
 
   // output file
   std::string output_file;
-  app.add_option("-o, --output", output_file, "output file, default: stdout")
-      ->option_text("<file>")
-      ->default_val("/dev/stdout");
+  auto output_opt = app.add_option("-o, --output", output_file, "output file, default: stdout")
+                        ->option_text("<file>")
+                        ->default_val("/dev/stdout");
+
+  // batch conversion
+  std::string out_dir;
+  auto out_dir_opt =
+      app.add_option("--out-dir", out_dir, "convert each input file into this directory")
+          ->option_text("<dir>")
+          ->excludes(output_opt);
+
+  std::vector<std::string> input_files;
+  app.add_option("files", input_files, "input files for --out-dir, default: names on stdin")
+      ->option_text("<file>...")
+      ->needs(out_dir_opt);
+
+  unsigned jobs = 0;
+  app.add_option("-j, --jobs", jobs, "conversions or parser threads, default: all cores")
+      ->option_text("<n>");
 
   // option output type
   std::string type;
   std::string css_fn;
+  const std::map<std::string_view, std::string_view> extensions{
+    { "pdf", ".pdf" },          { "html", ".html" },     { "fdx", ".fdx" },
+    { "screenplain", ".html" }, { "textplay", ".html" }, { "xml", ".xml" },
+    { "ast", ".ast" },
+  };
   std::map<std::string_view, std::string_view> css_list{
 #ifdef HAVE_PODOFO
     { "pdf", "" },
@@ -50,6 +849,7 @@ int main(int argc, char **argv) {
     { "screenplain", "screenplain.css" },
     { "textplay", "textplay.css" },
     { "xml", "fountain-xml.css" },
+    { "ast", "" },
   };
 
   type = "xml";  // default
@@ -61,15 +861,17 @@ int main(int argc, char **argv) {
     }
   }
 
-  app.add_option("-t, --type", type, "output type")->option_text("<type>")->default_val(type);
+  app.add_option("-t, --type", type, "output type, or several separated by commas")
+      ->option_text("<type>[,<type>...]")
+      ->default_val(type);
 
   // list types
   bool list_types = false;
   app.add_flag("--list-types", list_types, "list available types and exit");
 
   // css protocol+path+file
-  app.add_option("-c, --css-name", css_fn, "css protocol, path, and filename")
-      ->option_text("<file>");
+  auto css_opt = app.add_option("-c, --css-name", css_fn, "css protocol, path, and filename")
+                     ->option_text("<file>");
 
   // css protocol+path
   std::string css_path;
@@ -81,6 +883,38 @@ int main(int argc, char **argv) {
   bool css_embed = false;
   app.add_flag("-e, --css-embed", css_embed, "embed css in output");
 
+  // keywords for scripts not written in English
+  std::vector<std::string> extra_transitions;
+  app.add_option("--transitions", extra_transitions, "more transitions, such as \"FONDU:\"")
+      ->option_text("<text>[,<text>...]")
+      ->delimiter(',');
+  std::vector<std::string> extra_scene_prefixes;
+  app.add_option("--scene-prefixes", extra_scene_prefixes, "more scene heading prefixes")
+      ->option_text("<text>[,<text>...]")
+      ->delimiter(',');
+
+  // reuse outputs of unchanged inputs
+  std::string cache_dir;
+  app.add_option("--cache-dir", cache_dir, "reuse outputs rendered earlier from the same input")
+      ->option_text("<dir>");
+
+  // keep converting whenever the input is saved
+  bool watch_input = false;
+  app.add_flag("--watch", watch_input, "convert again each time the input file is saved")
+      ->excludes(out_dir_opt);
+
+  // answer requests until interrupted
+  std::string serve_endpoint;
+  app.add_option("--serve", serve_endpoint, "answer framed requests on a socket, - for stdio")
+      ->option_text("<socket>")
+      ->excludes(out_dir_opt);
+
+  // timings and counters
+  bool stats = false;
+  app.add_flag("--stats", stats, "print time per phase and counters to stderr");
+  bool stats_json = false;
+  app.add_flag("--stats-json", stats_json, "print --stats as JSON");
+
   // version
   app.set_version_flag(
       "-V, --version", cmd + " " VERSION, "Print version information and exit"
@@ -96,6 +930,16 @@ int main(int argc, char **argv) {
     return app.exit(e);
   }
 
+  if (stats || stats_json) {
+    Fountain::stats_enable();
+  }
+
+  if (!Fountain::addTransitions(extra_transitions) ||
+      !Fountain::addScenePrefixes(extra_scene_prefixes)) {
+    std::cerr << "error: transitions and scene prefixes must be 1 to 32 bytes" << std::endl;
+    return 1;
+  }
+
   // list output types and exit
   if (list_types) {
     std::cout << "output types:" << std::endl;
@@ -106,35 +950,108 @@ int main(int argc, char **argv) {
     return 0;
   }
 
-  // read input file
-  input = file_get_contents(input);
-
-  // execute desired action
-  std::string output;
-#ifdef HAVE_PODOFO
-  if (type == "pdf") {
-    Fountain::ftn2pdf(output_file, input);
-    return 0;
-  } else
+  if (!serve_endpoint.empty()) {
+#ifdef FOUNTAIN_HAVE_SERVER
+    // counters accumulate over every request, for the stats request type
+    Fountain::stats_enable();
+    if (jobs == 0) {
+      jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+    rtrim_inplace(css_path, "/");
+    return serve(serve_endpoint, jobs, ServerDefaults{ css_path, css_list, css_embed });
+#else
+    std::cerr << "error: --serve is not supported on this platform" << std::endl;
+    return 1;
 #endif
-      if (type == "html") {
-    output = Fountain::ftn2html(input, rtrim_inplace(css_path, "/") + "/" + css_fn, css_embed);
-  } else if (type == "fdx") {
-    output = Fountain::ftn2fdx(input);
-  } else if (type == "screenplain") {
-    output = Fountain::ftn2screenplain(
-        input, rtrim_inplace(css_path, "/") + "/" + css_fn, css_embed
-    );
-  } else if (type == "textplay") {
-    output =
-        Fountain::ftn2textplay(input, rtrim_inplace(css_path, "/") + "/" + css_fn, css_embed);
+  }
+
+  // each type is parsed once and rendered into its own file
+  const std::vector<std::string> types = split_string(type, ",");
+  rtrim_inplace(css_path, "/");
+  std::vector<Target> targets;
+  for (const auto &t : types) {
+    Target target{ t, css_path + "/" + css_fn, ".xml" };
+    if (types.size() > 1 && !css_opt->count()) {
+      const auto css = css_list.find(t);
+      target.css = css_path + "/" + std::string(css != css_list.end() ? css->second : "");
+    }
+    const auto extension = extensions.find(t);
+    if (extension != extensions.end()) {
+      target.extension = extension->second;
+    }
+    for (const auto &other : targets) {
+      if (other.extension == target.extension) {
+        target.extension = "." + t + target.extension;
+        break;
+      }
+    }
+    targets.push_back(target);
+  }
+
+  if (!cache_dir.empty()) {
+    std::error_code ec;
+    std::filesystem::create_directories(cache_dir, ec);
+  }
+
+  // convert each file into the output directory
+  if (!out_dir.empty()) {
+    if (input_files.empty()) {
+      for (std::string line; std::getline(std::cin, line);) {
+        if (!line.empty()) {
+          input_files.push_back(line);
+        }
+      }
+    }
+    const bool success =
+        convertBatch(input_files, out_dir, jobs, targets, css_embed, cache_dir);
+    if (Fountain::stats_enabled()) {
+      std::cerr << Fountain::stats_report(stats_json);
+    }
+    return success ? 0 : 1;
+  }
+
+  // several types are written to the output name with each extension added
+  std::vector<std::string> outputs;
+  if (targets.size() == 1) {
+    outputs.push_back(output_file);
+  } else if (!output_opt->count()) {
+    std::cerr << "error: several types need an output base name (-o)" << std::endl;
+    return 1;
   } else {
-    // default: xml
-    output = Fountain::ftn2xml(input, rtrim_inplace(css_path, "/") + "/" + css_fn, css_embed);
+    for (const auto &target : targets) {
+      outputs.push_back(output_file + target.extension);
+    }
+  }
+
+  if (watch_input) {
+#ifdef FOUNTAIN_HAVE_INOTIFY
+    if (!output_opt->count() || input_file == "/dev/stdin") {
+      std::cerr << "error: --watch needs an input file (-i) and output name (-o)" << std::endl;
+      return 1;
+    }
+    if (jobs == 0) {
+      jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return watch(input_file, targets, outputs, css_embed, jobs);
+#else
+    std::cerr << "error: --watch is not supported on this platform" << std::endl;
+    return 1;
+#endif
   }
 
-  // write output
-  file_set_contents(output_file, output);
+  // map or read input file
+  const FileView input(input_file);
+  if (jobs == 0) {
+    jobs = std::max(1u, std::thread::hardware_concurrency());
+  }
+  const std::string error = convert(input.view(), targets, outputs, css_embed, jobs, cache_dir);
+  if (Fountain::stats_enabled()) {
+    std::cerr << Fountain::stats_report(stats_json);
+  }
+  if (!error.empty()) {
+    std::cerr << "error: " << error << std::endl;
+    return 1;
+  }
 
   return 0;
 }
@@ -3,14 +3,170 @@
 
 #include "model_script.h"
 
-#include <regex>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string_view>
+#include <utility>
+#include <vector>
 
+#include "utils_scan.h"
+#include "utils_stats.h"
 #include "utils_string.h"
 
 namespace Fountain {
 
+namespace {
+
+// Emphasis levels, in the order asterisk pairs are resolved.
+struct Emphasis {
+  std::size_t width;
+  const char *open;
+  const char *close;
+};
+
+constexpr Emphasis emphasis[] = {
+  { 3, "<b><i>", "</i></b>" },
+  { 2, "<b>", "</b>" },
+  { 1, "<i>", "</i>" },
+};
+constexpr std::size_t emphasis_levels = sizeof(emphasis) / sizeof(emphasis[0]);
+
+// A run of consecutive asterisks.  Bits in opens and closes are emphasis levels.
+struct StarRun {
+  std::size_t pos;
+  std::size_t length;
+  std::size_t count;  // asterisks left over after pairing
+  unsigned opens = 0;
+  unsigned closes = 0;
+};
+
+// Pair runs one emphasis level at a time.  At each level, the tail of a run pairs with the
+// head of the next run that still has asterisks, when both have enough for the level.
+void resolveStarRuns(std::vector<StarRun> &runs) {
+  for (std::size_t level = 0; level < emphasis_levels; ++level) {
+    const std::size_t width = emphasis[level].width;
+    StarRun *prev = nullptr;
+    for (auto &run : runs) {
+      if (run.count == 0) {
+        continue;
+      }
+      if (prev && prev->count >= width && run.count >= width) {
+        prev->opens |= 1u << level;
+        prev->count -= width;
+        run.closes |= 1u << level;
+        run.count -= width;
+      }
+      prev = &run;
+    }
+  }
+}
+
+// Notes open with a blank line followed by "[[" and close with "]" followed by blank lines.
+std::string &parseNotes_inplace(std::string &input) {
+  static constexpr std::string_view note_open{ "\n\n[[" };
+  static constexpr std::string_view note_close{ "]\n\n\n" };
+
+  // notes with both ends
+  std::string output;
+  std::size_t pos = 0;
+  for (std::size_t open; (open = input.find(note_open, pos)) != std::string::npos;) {
+    const std::size_t close = input.find(note_close, open + note_open.length());
+    if (close == std::string::npos) {
+      break;
+    }
+    output.append(input, pos, open - pos);
+    output += "<note>";
+    output.append(input, open + note_open.length(), close - open - note_open.length());
+    output += "</note>";
+    pos = close + note_close.length();
+  }
+  if (pos > 0) {
+    output.append(input, pos);
+    input.swap(output);
+  }
+
+  // note without closing
+  if (std::size_t open = input.find(note_open); open != std::string::npos) {
+    input.replace(open, note_open.length(), "<note>");
+    input += "</note>";
+  }
+
+  // note without opening
+  if (std::size_t close = input.find(note_close); close != std::string::npos) {
+    input.replace(close, note_close.length(), "</note>");
+    input.insert(0, "<note>");
+  }
+
+  return input;
+}
+
+// Saved scripts: a header, fixed-size node and metadata records, then every string in record
+// order.  Integers are little-endian.
+constexpr char saved_magic[8] = { 'F', 'T', 'N', 'S', 'C', 'R', 'P', 'T' };
+constexpr std::uint32_t saved_version = 2;
+constexpr std::size_t saved_header = 24;   // magic, version, reserved, node and metadata counts
+constexpr std::size_t saved_node = 20;     // type, flags, key and value lengths, offset
+constexpr std::size_t saved_metadata = 8;  // key and value lengths
+constexpr std::uint32_t saved_dual = 1;    // node flag
+
+void putU32(std::string &output, const std::uint32_t value) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    output += static_cast<char>((value >> shift) & 0xff);
+  }
+}
+
+std::uint32_t getU32(const char *input) {
+  std::uint32_t value = 0;
+  for (int i = 3; i >= 0; --i) {
+    value = (value << 8) | static_cast<unsigned char>(input[i]);
+  }
+  return value;
+}
+
+// Tag opening the dialog block started by node
+std::string dialogOpen(const ScriptNode &node) {
+  switch (node.type) {
+    case ScriptNodeType::ftnDialogLeft:
+      return "<DualDialog><DialogLeft>" + node.value;
+    case ScriptNodeType::ftnDialogRight:
+      return "<DialogRight>" + node.value;
+    default:
+      return "<Dialog>" + node.key;
+  }
+}
+
+// Tag closing a dialog block of type, placed before the node of type ended_by
+std::string dialogClose(const ScriptNodeType &type, const ScriptNodeType &ended_by) {
+  const char *separator = (ended_by == ScriptNodeType::ftnPageBreak) ? "\n" : "";
+  switch (type) {
+    case ScriptNodeType::ftnDialogLeft:
+      return std::string("</DialogLeft>") + separator;
+    case ScriptNodeType::ftnDialogRight:
+      return std::string("</DialogRight>") + separator + "</DualDialog>" + separator;
+    default:
+      return std::string("</Dialog>") + separator;
+  }
+}
+
+// RenderContext::dialog_state values
+constexpr ScriptNodeType dialog_states[] = {
+  ScriptNodeType::ftnNone,
+  ScriptNodeType::ftnDialog,
+  ScriptNodeType::ftnDialogLeft,
+  ScriptNodeType::ftnDialogRight,
+};
+
+}  // namespace
+
 std::string ScriptNode::to_string(const int &flags) const {
-  static int dialog_state = 0;
+  RenderContext context;
+  return to_string(flags, context);
+}
+
+std::string ScriptNode::to_string(const int &flags, RenderContext &context) const {
+  int &dialog_state = context.dialog_state;
   std::string output;
 
   switch (type) {
@@ -25,9 +181,7 @@ std::string ScriptNode::to_string(const int &flags) const {
         break;
       }
       if (dialog_state) {
-        dialog_state == 1   ? output = "</Dialog>\n"
-        : dialog_state == 2 ? output = "</DialogLeft>\n"
-                            : output = "</DialogRight>\n</DualDialog>\n";
+        output = dialogClose(dialog_states[dialog_state], type);
         dialog_state = 0;
       }
       output += "<PageBreak></PageBreak>\n";
@@ -37,9 +191,7 @@ std::string ScriptNode::to_string(const int &flags) const {
         break;
       }
       if (dialog_state) {
-        dialog_state == 1   ? output = "</Dialog>"
-        : dialog_state == 2 ? output = "</DialogLeft>"
-                            : output = "</DialogRight></DualDialog>";
+        output = dialogClose(dialog_states[dialog_state], type);
         dialog_state = 0;
       }
       output += "<BlankLine></BlankLine>\n";
@@ -84,21 +236,21 @@ std::string ScriptNode::to_string(const int &flags) const {
         break;
       }
       dialog_state = 1;
-      output = "<Dialog>" + key;
+      output = dialogOpen(*this);
       break;
     case ScriptNodeType::ftnDialogLeft:
       if (flags & type) {
         break;
       }
       dialog_state = 2;
-      output = "<DualDialog><DialogLeft>" + value;
+      output = dialogOpen(*this);
       break;
     case ScriptNodeType::ftnDialogRight:
       if (flags & type) {
         break;
       }
       dialog_state = 3;
-      output = "<DialogRight>" + value;
+      output = dialogOpen(*this);
       break;
     case ScriptNodeType::ftnCharacter:
       if (flags & type) {
@@ -155,83 +307,379 @@ std::string ScriptNode::to_string(const int &flags) const {
 
 std::string Script::to_string(const int &flags) const {
   std::string output{ "<Fountain>\n" };
-  for (auto node : nodes) {
-    output += node.to_string(flags);
-  }
+  render([&](const std::string &text) { output += text; }, flags);
   output += "\n</Fountain>\n";
   return output;
 }
 
-std::string Script::parseNodeText(const std::string &input) {
-  try {
-    static const std::regex re_bolditalic(R"(\*{3}([^*]+?)\*{3})");
-    static const std::regex re_bold(R"(\*{2}([^*]+?)\*{2})");
-    static const std::regex re_italic(R"(\*{1}([^*]+?)\*{1})");
-    static const std::regex re_underline(R"(_([^_\n]+)_)");
-    std::string output = std::regex_replace(input, re_bolditalic, "<b><i>$1</i></b>");
-    output = std::regex_replace(output, re_bold, "<b>$1</b>");
-    output = std::regex_replace(output, re_italic, "<i>$1</i>");
-    output = std::regex_replace(output, re_underline, "<u>$1</u>");
+// A block that overlaps the range is tagged even if the range holds only part of it.
+void Script::render(
+    const std::function<void(const std::string &)> &write,
+    const int &flags,
+    const std::size_t begin,
+    const std::size_t end
+) const {
+  const std::size_t last = std::min(end, nodes.size());
+  auto dialog = std::upper_bound(
+      dialogs.cbegin(),
+      dialogs.cend(),
+      begin,
+      [](const std::size_t pos, const DialogBlock &block) { return pos < block.end; }
+  );
 
-    static const std::regex re_note_1(R"(
+  std::size_t pos = begin;
+  for (; dialog != dialogs.cend() && dialog->begin < last; ++dialog) {
+    for (; pos < dialog->begin; ++pos) {
+      write(nodes[pos].to_string(flags));
+    }
+    const ScriptNode &node = nodes[dialog->begin];
+    const bool tagged = !(flags & node.type);
+    if (tagged) {
+      write(dialogOpen(node));
+    }
+    for (pos = std::max(pos, dialog->begin + 1); pos < std::min(dialog->end, last); ++pos) {
+      write(nodes[pos].to_string(flags));
+    }
+    if (tagged) {
+      write(dialogClose(
+          node.type,
+          (dialog->end < nodes.size()) ? nodes[dialog->end].type : ScriptNodeType::ftnNone
+      ));
+    }
+  }
+  for (; pos < last; ++pos) {
+    write(nodes[pos].to_string(flags));
+  }
+}
 
-\[{2}([\S\s]*?)\]
+const OutlineEntry *Script::findScene(const std::string &number) const {
+  const auto scene = scene_numbers.find(number);
+  return (scene != scene_numbers.end()) ? &scenes[scene->second] : nullptr;
+}
 
-{2})");
-    static const std::regex re_note_2(R"(
+Script Script::extract(const std::size_t begin, const std::size_t end) const {
+  Script script;
+  const std::size_t last = std::min(end, nodes.size());
+  if (begin < last) {
+    script.nodes.assign(nodes.cbegin() + begin, nodes.cbegin() + last);
+  }
+  script.indexNodes();
+  return script;
+}
 
-\[{2}([\S\s]*?)$)");
-    static const std::regex re_note_3(R"(^([\S\s]*?)\]
+std::string &Script::parseNodeText_inplace(std::string &input) {
+  // nothing to format
+  if (scan_any(input, "*_") == std::string::npos &&
+      input.find("\n\n") == std::string::npos) {
+    return input;
+  }
 
-{2})");
-    output = std::regex_replace(output, re_note_1, "<note>$1</note>");
-    output = std::regex_replace(output, re_note_2, "<note>$1</note>");
-    output = std::regex_replace(output, re_note_3, "<note>$1</note>");
+  // collect asterisk runs and paired underscores
+  std::vector<StarRun> runs;
+  std::vector<std::size_t> underlines;
+  std::size_t underline_open = std::string::npos;
+  bool underline_text = false;
+  for (std::size_t pos = 0; pos < input.length(); ++pos) {
+    switch (input[pos]) {
+      case '*':
+        if (!runs.empty() && runs.back().pos + runs.back().length == pos) {
+          ++runs.back().length;
+          ++runs.back().count;
+        } else {
+          runs.push_back({ pos, 1, 1 });
+        }
+        underline_text = true;
+        break;
+      case '_':
+        if (underline_open != std::string::npos && underline_text) {
+          underlines.push_back(underline_open);
+          underlines.push_back(pos);
+          underline_open = std::string::npos;
+        } else {
+          underline_open = pos;
+        }
+        underline_text = false;
+        break;
+      case '\n':
+        underline_open = std::string::npos;
+        break;
+      default:
+        underline_text = true;
+        break;
+    }
+  }
 
-    return output;
-  } catch (std::regex_error &e) {
-    print_regex_error(e, __FILE__, __LINE__);
-    return input;
+  resolveStarRuns(runs);
+
+  std::string output;
+  output.reserve(input.length() + 8 * (runs.size() + underlines.size()));
+  auto run = runs.cbegin();
+  auto underline = underlines.cbegin();
+  for (std::size_t pos = 0; pos < input.length(); ++pos) {
+    if (run != runs.cend() && run->pos == pos) {
+      for (std::size_t level = 0; level < emphasis_levels; ++level) {
+        if (run->closes & (1u << level)) {
+          output += emphasis[level].close;
+        }
+      }
+      output.append(run->count, '*');
+      for (std::size_t level = emphasis_levels; level-- > 0;) {
+        if (run->opens & (1u << level)) {
+          output += emphasis[level].open;
+        }
+      }
+      pos += run->length - 1;
+      ++run;
+    } else if (underline != underlines.cend() && *underline == pos) {
+      output += ((underline - underlines.cbegin()) % 2) ? "</u>" : "<u>";
+      ++underline;
+    } else {
+      output += input[pos];
+    }
+  }
+
+  // notes set off by blank lines
+  if (output.find("\n\n") != std::string::npos) {
+    parseNotes_inplace(output);
   }
+
+  input.swap(output);
+  return input;
 }
 
 void Script::clear() {
   nodes.clear();
+  dialogs.clear();
+  scenes.clear();
+  sections.clear();
+  synopses.clear();
+  scene_numbers.clear();
+  metadata.clear();
   curr_node.clear();
+  source.clear();
+  checkpoints.clear();
+  open_boneyard = std::string::npos;
+}
+
+Script::Script(const std::string_view &text, const unsigned &threads) {
+  parseFountain(text, threads);
 }
 
-Script::Script(const std::string &text) {
-  parseFountain(text);
+void Script::save(std::ostream &out) const {
+  std::string header(saved_magic, sizeof(saved_magic));
+  putU32(header, saved_version);
+  putU32(header, 0);
+  putU32(header, nodes.size());
+  putU32(header, metadata.size());
+
+  std::string records;
+  records.reserve(nodes.size() * saved_node + metadata.size() * saved_metadata);
+  for (const auto &node : nodes) {
+    putU32(records, node.type);
+    putU32(records, node.dual ? saved_dual : 0);
+    putU32(records, node.key.length());
+    putU32(records, node.value.length());
+    putU32(records, node.offset);
+  }
+  for (const auto &[key, value] : metadata) {
+    putU32(records, key.length());
+    putU32(records, value.length());
+  }
+
+  out.write(header.data(), header.length());
+  out.write(records.data(), records.length());
+  for (const auto &node : nodes) {
+    out.write(node.key.data(), node.key.length());
+    out.write(node.value.data(), node.value.length());
+  }
+  for (const auto &[key, value] : metadata) {
+    out.write(key.data(), key.length());
+    out.write(value.data(), value.length());
+  }
+}
+
+bool Script::isSaved(const std::string_view &data) {
+  return data.length() >= saved_header &&
+         std::memcmp(data.data(), saved_magic, sizeof(saved_magic)) == 0;
+}
+
+// Strings are copied straight out of data after the records are checked against its length.
+bool Script::load(const std::string_view &data) {
+  clear();
+  if (!isSaved(data) || getU32(&data[8]) != saved_version) {
+    return false;
+  }
+  const std::size_t node_count = getU32(&data[16]);
+  const std::size_t metadata_count = getU32(&data[20]);
+  const std::size_t records = node_count * saved_node + metadata_count * saved_metadata;
+  if (records > data.length() - saved_header) {
+    return false;
+  }
+
+  const char *record = data.data() + saved_header;
+  std::size_t pool = saved_header + records;
+  auto take = [&](std::string &output, const std::size_t length) {
+    if (length > data.length() - pool) {
+      return false;
+    }
+    output.assign(data.data() + pool, length);
+    pool += length;
+    return true;
+  };
+
+  nodes.resize(node_count);
+  for (auto &node : nodes) {
+    node.type = static_cast<ScriptNodeType>(getU32(record));
+    node.dual = getU32(record + 4) & saved_dual;
+    node.offset = getU32(record + 16);
+    if (!take(node.key, getU32(record + 8)) || !take(node.value, getU32(record + 12))) {
+      clear();
+      return false;
+    }
+    record += saved_node;
+  }
+  for (std::size_t i = 0; i < metadata_count; ++i) {
+    std::string key;
+    std::string value;
+    if (!take(key, getU32(record)) || !take(value, getU32(record + 4))) {
+      clear();
+      return false;
+    }
+    metadata.emplace(std::move(key), std::move(value));
+    record += saved_metadata;
+  }
+  indexNodes();
+  return true;
 }
 
 void ScriptNode::clear() {
   type = ScriptNodeType::ftnUnknown;
   key.clear();
   value.clear();
+  dual = false;
+  offset = 0;
 }
 
-void Script::new_node(
-    const ScriptNodeType &type,
-    const std::string &key,
-    const std::string &value
-) {
+void Script::new_node(const ScriptNodeType &type, const std::string_view &key) {
   end_node();
-  curr_node = { type, key, value };
+  curr_node.type = type;
+  curr_node.key = key;
+  curr_node.offset = line_offset;
+  curr_node.value.clear();
 }
 
+// Nodes are moved into place, so each string is allocated once while parsing.
 void Script::end_node() {
   if (curr_node.type != ScriptNodeType::ftnUnknown) {
-    curr_node.value = parseNodeText(curr_node.value);
-    nodes.push_back(curr_node);
+    {
+      const StatsTimer timer(statInline);
+      parseNodeText_inplace(curr_node.value);
+    }
+    nodes.push_back(std::move(curr_node));
     curr_node.clear();
   }
 }
 
-void Script::append(const std::string &s) {
+void Script::append(const std::string_view &s) {
   if (!curr_node.value.empty()) {
     curr_node.value += '\n';
   }
   curr_node.value += s;
 }
 
+void Script::indexNodes() {
+  indexDialogs();
+  indexOutline();
+}
+
+// Pairs each dialog marked with ^ with the closest preceding unpaired dialog, and records
+// where each dialog block ends, in one pass with only the open block and unpaired blocks
+// at hand.
+void Script::indexDialogs() {
+  dialogs.clear();
+  std::vector<std::size_t> unpaired;
+  std::size_t open = std::string::npos;
+  for (std::size_t pos = 0; pos < nodes.size(); ++pos) {
+    ScriptNode &node = nodes[pos];
+    const bool ends_block =
+        node.type & (ScriptNodeType::ftnBlankLine | ScriptNodeType::ftnPageBreak);
+    const bool starts_block =
+        node.type & (ScriptNodeType::ftnDialog | ScriptNodeType::ftnDialogLeft |
+                     ScriptNodeType::ftnDialogRight);
+    if (open != std::string::npos && (ends_block || starts_block)) {
+      dialogs[open].end = pos;
+      open = std::string::npos;
+    }
+    if (!starts_block) {
+      continue;
+    }
+
+    open = dialogs.size();
+    dialogs.push_back({ pos, nodes.size() });
+    if (node.dual && !unpaired.empty()) {
+      DialogBlock &left = dialogs[unpaired.back()];
+      nodes[left.begin].type = ScriptNodeType::ftnDialogLeft;
+      node.type = ScriptNodeType::ftnDialogRight;
+      left.pair = open;
+      dialogs[open].pair = unpaired.back();
+      unpaired.pop_back();
+    } else {
+      node.type = ScriptNodeType::ftnDialog;
+      unpaired.push_back(open);
+    }
+  }
+}
+
+// Scenes and sections stay open until a later heading ends them.  Open sections are kept in
+// order of level, so each heading closes only the entries it ends.
+void Script::indexOutline() {
+  scenes.clear();
+  sections.clear();
+  synopses.clear();
+  scene_numbers.clear();
+  auto close = [&](OutlineEntry &entry, const std::size_t pos) {
+    entry.end = pos;
+    entry.end_offset = nodes[pos].offset;
+  };
+
+  std::size_t open_scene = std::string::npos;
+  std::vector<std::size_t> open_sections;
+  for (std::size_t pos = 0; pos < nodes.size(); ++pos) {
+    const ScriptNode &node = nodes[pos];
+    switch (node.type) {
+      case ScriptNodeType::ftnSceneHeader:
+        if (open_scene != std::string::npos) {
+          close(scenes[open_scene], pos);
+        }
+        open_scene = scenes.size();
+        scenes.push_back({ pos, nodes.size(), node.offset, std::string::npos });
+        if (!node.key.empty()) {
+          scene_numbers.emplace(node.key, open_scene);
+        }
+        break;
+      case ScriptNodeType::ftnSection:
+        if (open_scene != std::string::npos) {
+          close(scenes[open_scene], pos);
+          open_scene = std::string::npos;
+        }
+        while (!open_sections.empty() &&
+               nodes[sections[open_sections.back()].node].key >= node.key) {
+          close(sections[open_sections.back()], pos);
+          open_sections.pop_back();
+        }
+        open_sections.push_back(sections.size());
+        sections.push_back({ pos, nodes.size(), node.offset, std::string::npos });
+        break;
+      case ScriptNodeType::ftnSynopsis:
+        synopses.push_back({ pos, pos + 1, node.offset, std::string::npos });
+        if (pos + 1 < nodes.size()) {
+          synopses.back().end_offset = nodes[pos + 1].offset;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+}
+
 }  // namespace Fountain
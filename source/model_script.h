@@ -3,8 +3,13 @@
 
 #pragma once
 
+#include <cstddef>
+#include <functional>
 #include <map>
+#include <ostream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "config.h"
@@ -36,38 +41,136 @@ enum ScriptNodeType : unsigned long long {
   ftnSynopsis = 1ull << 20,
 };
 
+// State carried from one node to the next while nodes are rendered one at a time, as by a
+// StreamParser callback.  Each rendering owns its context, so scripts can be rendered
+// concurrently.
+struct RenderContext {
+  int dialog_state = 0;  // open dialog: 1 single, 2 left, 3 right
+};
+
 class ScriptNode {
  public:
+  // Dialog opened by a node is closed by a later blank line or page break rendered with the
+  // same context.
+  std::string to_string(const int &flags, RenderContext &context) const;
   std::string to_string(const int &flags = ScriptNodeType::ftnNone) const;
   void clear();
 
   ScriptNodeType type = ScriptNodeType::ftnUnknown;
   std::string key;
   std::string value;
+  bool dual = false;       // dialog whose character is marked with ^
+  std::size_t offset = 0;  // in the parsed text, of the line that starts the node
+};
+
+// Scene header, section or synopsis, with the nodes and text it spans
+struct OutlineEntry {
+  std::size_t node;        // scene header, section or synopsis node
+  std::size_t end;         // node after the span, or the node count
+  std::size_t offset;      // in the parsed text
+  std::size_t end_offset;  // in the parsed text, or npos at its end
+};
+
+// Dialog block: a Dialog, DialogLeft or DialogRight node and the character, parenthetical,
+// speech and lyric nodes that follow it, up to the blank line or page break ending the block.
+// The two blocks of a dual dialog refer to each other.
+struct DialogBlock {
+  std::size_t begin;                     // dialog node
+  std::size_t end;                       // node ending the block, or the node count
+  std::size_t pair = std::string::npos;  // other block of a dual dialog, in dialogs
 };
 
 class Script {
  public:
   Script() = default;
-  explicit Script(const std::string &text);
+  explicit Script(const std::string_view &text, const unsigned &threads = 1);
 
   void clear();
-  void parseFountain(const std::string &text);
+  // With several threads, a large script is split after blank lines and the parts are
+  // parsed concurrently.
+  void parseFountain(const std::string_view &text, const unsigned &threads = 1);
+
+  // Replace removed_len characters at offset in the parsed text with inserted_text,
+  // re-parsing only the paragraphs affected by the edit.
+  void applyEdit(
+      const std::size_t offset,
+      const std::size_t removed_len,
+      const std::string &inserted_text
+  );
+
   std::string to_string(const int &flags = ScriptNodeType::ftnNone) const;
 
+  // Passes the tagged text of nodes [begin, end) to write, a piece at a time.  Dialog blocks
+  // are taken from dialogs, so no state is carried between nodes.
+  void render(
+      const std::function<void(const std::string &)> &write,
+      const int &flags = ScriptNodeType::ftnNone,
+      const std::size_t begin = 0,
+      const std::size_t end = std::string::npos
+  ) const;
+
+  // Scene with the #number# given after its heading, or nullptr if there is none
+  const OutlineEntry *findScene(const std::string &number) const;
+
+  // Copies nodes [begin, end), without metadata, into a script that can be rendered with any
+  // renderer, such as a single scene from scenes or a section from sections.
+  Script extract(const std::size_t begin, const std::size_t end) const;
+
+  // Compact binary form of nodes and metadata, which loads much faster than parsing.  Data
+  // may be loaded directly from a mapped file.  A loaded script can be rendered, but not
+  // edited with applyEdit().
+  void save(std::ostream &out) const;
+  bool load(const std::string_view &data);
+  static bool isSaved(const std::string_view &data);
+
   std::vector<ScriptNode> nodes;
+  std::vector<DialogBlock> dialogs;  // in node order
+
+  // Outline, in node order.  A scene spans the nodes up to the next scene header or section,
+  // a section those up to the next section of the same or a higher level, and a synopsis only
+  // itself.
+  std::vector<OutlineEntry> scenes;
+  std::vector<OutlineEntry> sections;
+  std::vector<OutlineEntry> synopses;
+  std::unordered_map<std::string, std::size_t> scene_numbers;  // index in scenes
+
   std::map<std::string, std::string> metadata;
 
  private:
+  friend class StreamParser;
+
+  struct ParseState {
+    bool has_header = false;
+    int section = 1;  // used for synopsis
+  };
+
+  // Start of a line after a blank line, where parsing can resume
+  struct Checkpoint {
+    std::size_t offset;  // in source
+    std::size_t node;    // nodes before this point
+    int section;
+  };
+
+  std::string source;
+  std::size_t line_offset = 0;  // in source, of the line being parsed
+  std::vector<Checkpoint> checkpoints;
+  std::size_t open_boneyard = std::string::npos;  // first "/*" without "*/"
+
   ScriptNode curr_node;
-  std::string parseNodeText(const std::string &input);
-  void new_node(
-      const ScriptNodeType &type,
-      const std::string &key = "",
-      const std::string &value = ""
-  );
+  std::string &parseNodeText_inplace(std::string &input);
+  void new_node(const ScriptNodeType &type, const std::string_view &key = {});
   void end_node();
-  void append(const std::string &s);
+  void append(const std::string_view &s);
+  void parseLine(const std::string_view &line, ParseState &state);
+  std::size_t parseRange(
+      const std::string &text,
+      const std::size_t begin,
+      const std::size_t end,
+      ParseState &state
+  );
+  void indexNodes();
+  void indexDialogs();
+  void indexOutline();
 };
 
 }  // namespace Fountain
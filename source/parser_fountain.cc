@@ -3,39 +3,170 @@
 
 #include "parser_fountain.h"
 
-#include <regex>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "model_script.h"
+#include "utils_scan.h"
+#include "utils_stats.h"
 #include "utils_string.h"
 
 namespace Fountain {
 namespace {
 
-// --- Helper functions from original fountain.cc ---
+// --- Line classification tables ---
 
-bool isForced(const std::string &input) {
-  if (input.empty()) {
+// Longest transition or scene heading prefix
+constexpr std::size_t max_keyword = 32;
+
+// Set of uppercase keywords in an open-addressing hash table, so a lookup costs one hash and
+// usually one comparison.  The English keywords are added at compile time, and extra ones at
+// startup through addTransitions() and addScenePrefixes().
+class KeywordTable {
+ public:
+  template <std::size_t N>
+  constexpr explicit KeywordTable(const std::string_view (&words)[N]) {
+    for (const auto &word : words) {
+      add(word);
+    }
+  }
+
+  // Returns false if the word is empty, too long, or the table is full.
+  constexpr bool add(const std::string_view &word) {
+    if (word.empty() || word.length() > max_keyword || (count + 1) * 2 > slots) {
+      return false;
+    }
+    std::size_t slot = hash(word) % slots;
+    for (; !table[slot].empty(); slot = (slot + 1) % slots) {
+      if (table[slot] == word) {
+        return true;
+      }
+    }
+    table[slot] = word;
+    ++count;
+    longest_word = std::max(longest_word, word.length());
+    const unsigned char first = word[0];
+    first_bytes[first] = true;
+    if (first >= 'A' && first <= 'Z') {
+      first_bytes[first - 'A' + 'a'] = true;
+    }
+    return true;
+  }
+
+  constexpr bool contains(const std::string_view &word) const {
+    std::size_t slot = hash(word) % slots;
+    for (; !table[slot].empty(); slot = (slot + 1) % slots) {
+      if (table[slot] == word) {
+        return true;
+      }
+    }
     return false;
   }
-  switch (input[0]) {
-    case '#':
-    case '=':
-    case '>':
-    case '!':
-    case '.':
-    case '(':
-    case '@':
-    case '*':
-    case '_':
-    case '~':
+
+  // Whether some keyword begins with c, ignoring case
+  constexpr bool startsWith(const char c) const {
+    return first_bytes[static_cast<unsigned char>(c)];
+  }
+
+  constexpr std::size_t longest() const {
+    return longest_word;
+  }
+
+ private:
+  static constexpr std::size_t slots = 256;
+
+  // FNV-1a
+  static constexpr std::uint32_t hash(const std::string_view &word) {
+    std::uint32_t h = 2166136261u;
+    for (const char c : word) {
+      h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return h;
+  }
+
+  std::string_view table[slots] = {};
+  bool first_bytes[256] = {};
+  std::size_t count = 0;
+  std::size_t longest_word = 0;
+};
+
+constexpr std::string_view english_transitions[] = {
+  "DISSOLVE:",      "END CREDITS:", "FADE IN:",         "FREEZE FRAME:",
+  "INTERCUT WITH:", "IRIS IN:",     "OPENING CREDITS:", "SPLIT SCREEN:",
+  "STOCK SHOT:",    "TIME CUT:",    "TITLE OVER:",      "WIPE:",
+};
+
+// Matched when followed by "." or a space.  INT./EXT and EXT./INT are covered by INT and EXT.
+constexpr std::string_view english_scene_prefixes[] = {
+  "INT", "EXT", "EST", "INT/EXT", "EXT/INT", "I/E", "E/I",
+};
+
+static_assert(KeywordTable(english_transitions).contains("FADE IN:"));
+static_assert(KeywordTable(english_scene_prefixes).startsWith('i'));
+
+// Constant-initialized from the tables above.  Extra keywords are owned by extra_keywords.
+KeywordTable transitions(english_transitions);
+KeywordTable scene_prefixes(english_scene_prefixes);
+std::deque<std::string> extra_keywords;
+
+// Adds words in uppercase, keeping them alive in extra_keywords.
+bool addKeywords(KeywordTable &table, const std::vector<std::string> &words) {
+  bool added = true;
+  for (const auto &word : words) {
+    added = table.add(extra_keywords.emplace_back(to_upper(ws_trim(word)))) && added;
+  }
+  return added;
+}
+
+// Section levels as node keys.  Level 0 is text before the first section of a part parsed on
+// its own thread.
+constexpr std::string_view section_keys[] = { "0", "1", "2", "3", "4", "5", "6" };
+
+// First bytes that force an element type
+struct ForcedTable {
+  bool forced[256] = {};
+
+  constexpr ForcedTable() {
+    for (const char c : std::string_view("#=>!.(@*_~")) {
+      forced[static_cast<unsigned char>(c)] = true;
+    }
+  }
+};
+constexpr ForcedTable forced_table;
+
+// Whether input begins with a scene heading prefix followed by "." or a space, ignoring case
+bool hasScenePrefix(const std::string_view &input) {
+  if (input.empty() || !scene_prefixes.startsWith(input[0])) {
+    return false;
+  }
+  stats_count(statLookups);
+  char upper[max_keyword + 1];
+  const std::size_t limit = std::min(input.length(), scene_prefixes.longest() + 1);
+  for (std::size_t i = 0; i < limit; ++i) {
+    const char c = input[i];
+    if ((c == '.' || c == ' ') && scene_prefixes.contains({ upper, i })) {
       return true;
+    }
+    upper[i] = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
   }
   return false;
 }
 
-bool isTransition(const std::string &input) {
+// --- Helper functions from original fountain.cc ---
+
+bool isForced(const std::string_view &input) {
+  return !input.empty() && forced_table.forced[static_cast<unsigned char>(input[0])];
+}
+
+bool isTransition(const std::string_view &input) {
   if (input.empty()) {
     return false;
   }
@@ -46,50 +177,32 @@ bool isTransition(const std::string &input) {
   if (isForced(input)) {
     return false;
   }
-  if (len > 20 || len < 5) {
+  if (len < 5 || len > std::max<std::size_t>(20, transitions.longest())) {
     return false;
   }
   if (!is_upper(input)) {
     return false;
   }
 
-  std::string compare = input.substr(len - 4);
-  if (compare == " TO:") {
+  if (len <= 20 && (input.substr(len - 4) == " TO:" || input.substr(len - 5) == " OUT." ||
+                    input.substr(0, 7) == "CUT TO ")) {
     return true;
   }
-  compare = input.substr(len - 5);
-  if (compare == " OUT.") {
-    return true;
-  }
-  compare = input.substr(0, 7);
-  if (compare == "CUT TO ") {
-    return true;
-  }
-
-  const char *transitions[] = {
-    "DISSOLVE:",      "END CREDITS:", "FADE IN:",         "FREEZE FRAME:",
-    "INTERCUT WITH:", "IRIS IN:",     "OPENING CREDITS:", "SPLIT SCREEN:",
-    "STOCK SHOT:",    "TIME CUT:",    "TITLE OVER:",      "WIPE:",
-  };
-  for (auto str : transitions) {
-    if (input == std::string(str)) {
-      return true;
-    }
-  }
-  return false;
+  stats_count(statLookups);
+  return transitions.contains(input);
 }
 
-std::string parseTransition(const std::string &input) {
+std::string_view parseTransition(const std::string_view &input) {
   if (input.empty()) {
     return {};
   }
   if (input[0] == '>') {
-    return to_upper(ws_trim(input.substr(1)));
+    return ws_trim_view(input.substr(1));
   }
-  return to_upper(ws_trim(input));
+  return ws_trim_view(input);
 }
 
-bool isSceneHeader(const std::string &input) {
+bool isSceneHeader(const std::string_view &input) {
   if (input.length() < 2) {
     return false;
   }
@@ -99,66 +212,47 @@ bool isSceneHeader(const std::string &input) {
   if (isForced(input)) {
     return false;
   }
-  try {
-    static const std::regex re_scene_header(
-        R"(^(INT|EXT|EST|INT\.?/EXT|EXT\.?/INT|I/E|E/I)[\.\ ])", std::regex_constants::icase
-    );
-    if (std::regex_search(input, re_scene_header)) {
-      return true;
-    }
-  } catch (std::regex_error &e) {
-    print_regex_error(e, __FILE__, __LINE__);
-  }
-  return false;
+  return hasScenePrefix(input);
 }
 
-auto parseSceneHeader(const std::string &input) {
-  std::string first, second;
+// Heading and scene number
+auto parseSceneHeader(const std::string_view &input) {
+  std::string_view first, second;
   bool forced_scene = (input[0] == '.' && input[1] != '.');
-  const std::size_t pos = input.find("#");
+  const std::size_t pos = input.find('#');
   if (pos < input.length() - 1 && input.back() == '#') {
     if (forced_scene) {
-      first = ws_trim(input.substr(1, pos - 1));
-      second = ws_trim(input.substr(pos + 1, input.length() - pos - 3));
+      first = ws_trim_view(input.substr(1, pos - 1));
+      second = ws_trim_view(input.substr(pos + 1, input.length() - pos - 3));
     } else {
-      first = ws_trim(input.substr(0, pos));
-      second = ws_trim(input.substr(pos + 1, input.length() - pos - 2));
+      first = ws_trim_view(input.substr(0, pos));
+      second = ws_trim_view(input.substr(pos + 1, input.length() - pos - 2));
     }
   } else {
-    first = ws_trim(input.substr(forced_scene ? 1 : 0));
+    first = ws_trim_view(input.substr(forced_scene ? 1 : 0));
   }
   return std::make_pair(first, second);
 }
 
-bool isCenter(const std::string &input) {
+bool isCenter(const std::string_view &input) {
   if (input.length() < 2) {
     return false;
   }
   return (input[0] == '>' && input.back() == '<');
 }
 
-bool isNotation(const std::string &input) {
+bool isNotation(const std::string_view &input) {
   if (input.length() < 4) {
     return false;
   }
   if (input[0] != '[' || input[1] != '[') {
     return false;
   }
-  static const std::string strWhiteSpace{ FOUNTAIN_WHITESPACE };
-  if (strWhiteSpace.find(input.back()) != std::string::npos) {
-    std::string s = ws_rtrim(input);
-    if (s[s.length() - 1] == ']' && s[s.length() - 2] == ']') {
-      return true;
-    }
-  } else {
-    if (input[input.length() - 1] == ']' && input[input.length() - 2] == ']') {
-      return true;
-    }
-  }
-  return false;
+  const std::string_view s = ws_rtrim_view(input);
+  return s.length() >= 2 && s[s.length() - 1] == ']' && s[s.length() - 2] == ']';
 }
 
-bool isCharacter(const std::string &input) {
+bool isCharacter(const std::string_view &input) {
   if (input.empty()) {
     return false;
   }
@@ -168,8 +262,8 @@ bool isCharacter(const std::string &input) {
   if (isForced(input)) {
     return false;
   }
-  std::size_t pos = input.find("(");
-  if (pos != std::string::npos && input.find(")") != std::string::npos) {
+  std::size_t pos = input.find('(');
+  if (pos != std::string_view::npos && input.find(')') != std::string_view::npos) {
     if (is_upper(input.substr(0, pos))) {
       return true;
     }
@@ -179,387 +273,797 @@ bool isCharacter(const std::string &input) {
   return false;
 }
 
-std::string parseCharacter(const std::string &input) {
-  std::string output;
+std::string_view parseCharacter(const std::string_view &input) {
+  std::string_view output = input;
   if (input[0] == '@') {
-    output = ws_ltrim(input.substr(1));
-  } else {
-    output = input;
+    output = ws_ltrim_view(input.substr(1));
   }
-  if (output.back() == '^') {
-    output = ws_rtrim(output.substr(0, output.length() - 1));
+  if (!output.empty() && output.back() == '^') {
+    output = ws_rtrim_view(output.substr(0, output.length() - 1));
   }
   return output;
 }
 
-bool isDualDialog(const std::string &input) {
+bool isDualDialog(const std::string_view &input) {
   return (!input.empty() && input.back() == '^');
 }
 
-bool isParenthetical(const std::string &input) {
+bool isParenthetical(const std::string_view &input) {
   if (input.empty()) {
     return false;
   }
   if (input[0] != '(') {
     return false;
   }
-  static std::string strWhiteSpace{ FOUNTAIN_WHITESPACE };
-  if (strWhiteSpace.find(input.back()) != std::string::npos) {
-    std::string s = ws_rtrim(input);
-    if (s[s.length() - 1] == ')') {
-      return true;
-    }
-  } else {
-    if (input[input.length() - 1] == ')') {
-      return true;
-    }
-  }
-  return false;
+  const std::string_view s = ws_rtrim_view(input);
+  return s[s.length() - 1] == ')';
 }
 
-bool isContinuation(const std::string &input) {
+bool isContinuation(const std::string_view &input) {
   if (input.empty()) {
     return false;
   }
-  return (input.find_first_not_of(FOUNTAIN_WHITESPACE) == std::string::npos);
+  return scan_whitespace(input) == input.length();
 }
 
-auto parseKeyValue(const std::string &input) {
-  std::string key, value;
+// Key, not yet lowercase, and value of a title page line
+auto parseKeyValue(const std::string_view &input) {
+  std::string_view key, value;
   std::size_t pos = input.find(':');
-  if (pos != std::string::npos) {
-    key = to_lower(ws_trim(input.substr(0, pos)));
-    value = ws_trim(input.substr(pos + 1));
+  if (pos != std::string_view::npos) {
+    key = ws_trim_view(input.substr(0, pos));
+    value = ws_trim_view(input.substr(pos + 1));
   }
   return std::make_pair(key, value);
 }
 
-std::string &parseEscapeSequences_inplace(std::string &input) {
-  for (std::size_t pos = 0; pos < input.length();) {
-    switch (input[pos]) {
-      case '\t':
-        input.replace(pos, 1, "    ");
-        pos += 4;
-        break;
-      case '\\':
-        if (pos + 1 < input.length()) {
-          switch (input[pos + 1]) {
-            case '&':
-              input.replace(pos, 2, "&#38;");
-              pos += 5;
-              break;
-            case '*':
-              input.replace(pos, 2, "&#42;");
-              pos += 5;
-              break;
-            case '_':
-              input.replace(pos, 2, "&#95;");
-              pos += 5;
-              break;
-            case ':':
-              input.replace(pos, 2, "&#58;");
-              pos += 5;
-              break;
-            case '[':
-              input.replace(pos, 2, "&#91;");
-              pos += 5;
-              break;
-            case ']':
-              input.replace(pos, 2, "&#93;");
-              pos += 5;
-              break;
-            case '\\':
-              input.replace(pos, 2, "&#92;");
-              pos += 5;
-              break;
-            case '<':
-              input.replace(pos, 2, "&#60;");
-              pos += 5;
-              break;
-            case '>':
-              input.replace(pos, 2, "&#62;");
-              pos += 5;
-              break;
-            case '.':
-              input.replace(pos, 2, "&#46;");
-              pos += 5;
-              break;
-            default:
-              pos += 2;
-              break;
-          }
-        } else {
-          ++pos;
-        }
-        break;
-      default:
-        ++pos;
-        break;
-    }
+// Returns the entity for an escaped character, or nullptr if it is not escapable.
+const char *escapeEntity(const char c) {
+  switch (c) {
+    case '&':
+      return "&#38;";
+    case '*':
+      return "&#42;";
+    case '_':
+      return "&#95;";
+    case ':':
+      return "&#58;";
+    case '[':
+      return "&#91;";
+    case ']':
+      return "&#93;";
+    case '\\':
+      return "&#92;";
+    case '<':
+      return "&#60;";
+    case '>':
+      return "&#62;";
+    case '.':
+      return "&#46;";
   }
-  return input;
+  return nullptr;
 }
 
-}  // namespace
+bool isAlnum(const char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
 
-// --- Main parseFountain implementation ---
-void Script::parseFountain(const std::string &text) {
-  clear();
-  if (text.empty()) {
-    return;
+// Reads preprocessed lines from Fountain text.  Boneyard (/* */) is stripped, stray
+// ampersands are encoded, and tabs and escape sequences are expanded in a single pass.
+// Reading may start at any line that begins outside boneyard.
+class LineReader {
+ public:
+  LineReader(const std::string &text, const std::size_t offset = 0)
+      : text(text), len(text.length()), pos(offset), prev_avail(offset > 0) {}
+
+  // Reads the next line.  Returns false when there are no more lines.
+  bool next(std::string_view &out);
+
+  // Offset of the line after the last one read, or npos if there are no more lines.
+  std::size_t offset() const {
+    return pos;
   }
 
-  std::vector<std::string> lines;
-  try {
-    static const std::regex re_comment(R"(/\*[\S\s]*?\*/)");
-    std::string strTmp = std::regex_replace(text, re_comment, "");
-    static const std::regex re_ampersand(R"(([^\\])&(?!#?[a-zA-Z0-9]+;))");
-    strTmp = std::regex_replace(strTmp, re_ampersand, "$1&#38;");
-    parseEscapeSequences_inplace(strTmp);
-    lines = split_lines(strTmp);
-  } catch (std::regex_error &e) {
-    print_regex_error(e, __FILE__, __LINE__);
+  // Offset of the last line read
+  std::size_t start() const {
+    return begin;
   }
 
-  // determine whether to try to extract header
-  bool has_header = false;
-  try {
-    static const std::regex re_has_header(R"(^[^\s:]+:\s)");
-    if (std::regex_search(text, re_has_header)) {
-      has_header = true;
-    }
-  } catch (std::regex_error &e) {
-    print_regex_error(e, __FILE__, __LINE__);
+  // Offset of the first "/*" read that has no closing "*/", or npos.
+  std::size_t unclosedBoneyard() const {
+    return unclosed;
   }
 
-  int currSection = 1;  // used for synopsis
+ private:
+  std::size_t boneyardEnd(const std::size_t at);
+  std::size_t skipBoneyard(std::size_t at);
+  bool isEntity(std::size_t at);
 
-  for (auto &line : lines) {
-    std::string s = ws_ltrim(line);
+  const std::string &text;
+  const std::size_t len;
+  std::size_t pos;
+  std::size_t begin = 0;
+  std::size_t close = 0;  // first "*/" at or after close_from
+  std::size_t close_from = std::string::npos;
+  std::size_t unclosed = std::string::npos;
+  char prev = '\n';
+  bool prev_avail;  // whether prev may anchor an ampersand encoding
+  std::string line;
+};
+
+std::size_t LineReader::boneyardEnd(const std::size_t at) {
+  if (at + 1 >= len || text[at] != '/' || text[at + 1] != '*') {
+    return at;
+  }
+  if (at + 2 < close_from || (close != std::string::npos && close < at + 2)) {
+    close_from = at + 2;
+    close = text.find("*/", close_from);
+  }
+  if (close == std::string::npos) {
+    unclosed = std::min(unclosed, at);
+    return at;
+  }
+  return close + 2;
+}
+
+std::size_t LineReader::skipBoneyard(std::size_t at) {
+  for (std::size_t next; (next = boneyardEnd(at)) != at;) {
+    at = next;
+  }
+  return at;
+}
 
-    if (has_header) {
-      if (s.find(':') != std::string::npos) {
-        metadata[curr_node.key] = trim_inplace(curr_node.value);
-        auto kv = parseKeyValue(s);
-        if (!kv.first.empty()) {
-          new_node(ScriptNodeType::ftnKeyValue, kv.first);
+// whether an ampersand already begins an entity: &name; or &#num;
+bool LineReader::isEntity(std::size_t at) {
+  at = skipBoneyard(at + 1);
+  if (at < len && text[at] == '#') {
+    at = skipBoneyard(at + 1);
+  }
+  bool has_name = false;
+  while (at < len && isAlnum(text[at])) {
+    has_name = true;
+    at = skipBoneyard(at + 1);
+  }
+  return has_name && at < len && text[at] == ';';
+}
+
+bool LineReader::next(std::string_view &out) {
+  if (pos == std::string::npos) {
+    return false;
+  }
+  begin = pos;
+  line.clear();
+
+  for (pos = skipBoneyard(pos); pos < len; pos = skipBoneyard(pos)) {
+    const char c = text[pos];
+    switch (c) {
+      case '\n':
+        prev = c;
+        prev_avail = true;
+        ++pos;
+        out = line;
+        return true;
+      case '\t':
+        line.append(4, ' ');
+        prev_avail = true;
+        ++pos;
+        break;
+      case '&':
+        if (prev_avail && prev != '\\' && !isEntity(pos)) {
+          line.append("&#38;");
+          prev_avail = false;
+        } else {
+          line += c;
+          prev_avail = true;
+        }
+        ++pos;
+        break;
+      case '\\': {
+        const std::size_t next = skipBoneyard(pos + 1);
+        if (next >= len) {
+          line += c;
+          prev_avail = true;
+          ++pos;
+          break;
+        }
+        prev = text[next];
+        prev_avail = true;
+        pos = next + 1;
+        if (const char *entity = escapeEntity(prev)) {
+          line.append(entity);
+          continue;
         }
-        if (!kv.second.empty()) {
-          append(kv.second);
+        line += c;
+        if (prev == '\n') {
+          out = line;
+          return true;
         }
+        line += prev;
         continue;
       }
-      if (line.empty()) {
-        metadata[curr_node.key] = trim_inplace(curr_node.value);
-        end_node();
-        has_header = false;
-        continue;
-      } else {
-        trim_inplace(s);
-        if (!s.empty()) {
-          append(s);
-        }
+      default: {
+        // copy up to the next byte that needs attention in one piece
+        const std::size_t run = scan_any(std::string_view(text).substr(pos + 1), "\n\t&\\/");
+        const std::size_t end = (run == std::string::npos) ? len : pos + 1 + run;
+        line.append(text, pos, end - pos);
+        prev = text[end - 1];
+        prev_avail = true;
+        pos = end;
         continue;
       }
     }
+    prev = c;
+  }
 
-    // Blank Line
-    if (line.empty()) {
-      new_node(ScriptNodeType::ftnBlankLine, line);
-      end_node();
-      continue;
+  // last line
+  pos = std::string::npos;
+  out = line;
+  return true;
+}
+
+bool isDialogMarker(const ScriptNode &node) {
+  return node.type & (ScriptNodeType::ftnDialog | ScriptNodeType::ftnDialogLeft |
+                      ScriptNodeType::ftnDialogRight);
+}
+
+// Whether the text begins with a title page key: "^[^\s:]+:\s"
+bool hasHeader(const std::string_view &text) {
+  const std::size_t pos = text.find_first_of(FOUNTAIN_WHITESPACE ":");
+  return pos != std::string::npos && pos > 0 && text[pos] == ':' && pos + 1 < text.length() &&
+         std::string_view{ FOUNTAIN_WHITESPACE }.find(text[pos + 1]) != std::string::npos;
+}
+
+// Ranges smaller than this are not worth parsing on their own thread.
+constexpr std::size_t parallel_chunk = 256 * 1024;
+
+// Line starts after a blank line outside boneyard, about chunk bytes apart.  Parsing can start
+// at any of these with no state but the current section.
+std::vector<std::size_t> splitPoints(const std::string &text, const std::size_t chunk) {
+  std::vector<std::size_t> points;
+  std::size_t open = text.find("/*");
+  std::size_t close = (open == std::string::npos) ? open : text.find("*/", open + 2);
+  for (std::size_t target = chunk; target < text.length();) {
+    const std::size_t blank = text.find("\n\n", target);
+    if (blank == std::string::npos || blank + 2 >= text.length()) {
+      break;
     }
 
-    // Continuation
-    if (isContinuation(line)) {
-      if (curr_node.type != ScriptNodeType::ftnUnknown) {
-        append(" ");
-      } else {
-        new_node(ScriptNodeType::ftnContinuation, line);
-        end_node();
-      }
+    // an unterminated "/*" is not boneyard
+    while (close != std::string::npos && close + 2 <= blank) {
+      open = text.find("/*", close + 2);
+      close = (open == std::string::npos) ? open : text.find("*/", open + 2);
+    }
+    if (close != std::string::npos && open < blank + 2) {
+      target = close + 2;
       continue;
     }
 
-    // Notation
-    if (isNotation(s)) {
-      if (line[0] == ' ' || line[0] == '\t' || line.back() == ' ' || line.back() == '\t') {
-        append(s);
-      } else {
-        append(s);
-        new_node(ScriptNodeType::ftnBlankLine);
-        end_node();
+    points.push_back(blank + 2);
+    target = blank + 2 + chunk;
+  }
+  return points;
+}
+
+}  // namespace
+
+bool addTransitions(const std::vector<std::string> &words) {
+  return addKeywords(transitions, words);
+}
+
+bool addScenePrefixes(const std::vector<std::string> &words) {
+  return addKeywords(scene_prefixes, words);
+}
+
+// --- Main parseFountain implementation ---
+void Script::parseLine(const std::string_view &line, ParseState &state) {
+  const std::string_view s = ws_ltrim_view(line);
+
+  if (state.has_header) {
+    if (s.find(':') != std::string_view::npos) {
+      metadata[curr_node.key] = trim_inplace(curr_node.value);
+      auto kv = parseKeyValue(s);
+      if (!kv.first.empty()) {
+        new_node(ScriptNodeType::ftnKeyValue);
+        to_lower_inplace(curr_node.key.assign(kv.first));
       }
-      continue;
+      if (!kv.second.empty()) {
+        append(kv.second);
+      }
+      return;
     }
-
-    // Page Break
-    if (begins_with(s, "===")) {
-      new_node(ScriptNodeType::ftnPageBreak, s);
+    if (line.empty()) {
+      metadata[curr_node.key] = trim_inplace(curr_node.value);
       end_node();
-      continue;
+      state.has_header = false;
+      return;
+    } else {
+      const std::string_view value = ws_trim_view(s);
+      if (!value.empty()) {
+        append(value);
+      }
+      return;
     }
+  }
+
+  // Blank Line
+  if (line.empty()) {
+    new_node(ScriptNodeType::ftnBlankLine);
+    end_node();
+    return;
+  }
 
-    // Transition
-    if (curr_node.type == ScriptNodeType::ftnUnknown && isTransition(s)) {
-      new_node(ScriptNodeType::ftnTransition);
-      append(parseTransition(s));
+  // Continuation
+  if (isContinuation(line)) {
+    if (curr_node.type != ScriptNodeType::ftnUnknown) {
+      append(" ");
+    } else {
+      new_node(ScriptNodeType::ftnContinuation, line);
       end_node();
-      continue;
     }
+    return;
+  }
 
-    // Scene Header
-    if (curr_node.type == ScriptNodeType::ftnUnknown && isSceneHeader(s)) {
-      auto scene = parseSceneHeader(s);
-      new_node(ScriptNodeType::ftnSceneHeader, scene.second);
-      append(scene.first);
+  // Notation
+  if (isNotation(s)) {
+    if (line[0] == ' ' || line[0] == '\t' || line.back() == ' ' || line.back() == '\t') {
+      append(s);
+    } else {
+      append(s);
+      new_node(ScriptNodeType::ftnBlankLine);
       end_node();
-      continue;
     }
+    return;
+  }
 
-    // Parenthetical
-    if (isParenthetical(s)) {
-      if (!nodes.empty()) {
-        ScriptNodeType ct = nodes.back().type;
-        if (ct == ScriptNodeType::ftnParenthetical || ct == ScriptNodeType::ftnCharacter ||
-            ct == ScriptNodeType::ftnSpeech) {
-          new_node(ScriptNodeType::ftnParenthetical);
-          append(ws_trim(s));
-          end_node();
-          continue;
-        }
+  // Page Break
+  if (begins_with(s, "===")) {
+    new_node(ScriptNodeType::ftnPageBreak, s);
+    end_node();
+    return;
+  }
+
+  // Transition
+  if (curr_node.type == ScriptNodeType::ftnUnknown && isTransition(s)) {
+    new_node(ScriptNodeType::ftnTransition);
+    append(parseTransition(s));
+    to_upper_inplace(curr_node.value);
+    end_node();
+    return;
+  }
+
+  // Scene Header
+  if (curr_node.type == ScriptNodeType::ftnUnknown && isSceneHeader(s)) {
+    auto scene = parseSceneHeader(s);
+    new_node(ScriptNodeType::ftnSceneHeader, scene.second);
+    append(scene.first);
+    end_node();
+    return;
+  }
+
+  // Parenthetical
+  if (isParenthetical(s)) {
+    if (!nodes.empty()) {
+      ScriptNodeType ct = nodes.back().type;
+      if (ct == ScriptNodeType::ftnParenthetical || ct == ScriptNodeType::ftnCharacter ||
+          ct == ScriptNodeType::ftnSpeech) {
+        new_node(ScriptNodeType::ftnParenthetical);
+        append(ws_trim_view(s));
+        end_node();
+        return;
       }
     }
+  }
 
-    // Speech / Lyric
-    if (curr_node.type == ScriptNodeType::ftnSpeech) {
+  // Speech / Lyric
+  if (curr_node.type == ScriptNodeType::ftnSpeech) {
+    if (s.length() > 1 && s[0] == '~') {
+      new_node(ScriptNodeType::ftnLyric);
+      append(s.substr(1));
+      return;
+    } else {
+      append(s);
+      return;
+    }
+  } else if (curr_node.type == ScriptNodeType::ftnLyric) {
+    if (s.length() > 1 && s[0] == '~') {
+      append(s.substr(1));
+      return;
+    } else {
+      new_node(ScriptNodeType::ftnSpeech);
+      append(s);
+      return;
+    }
+  } else if (!nodes.empty()) {
+    ScriptNodeType ct = nodes.back().type;
+    if (ct == ScriptNodeType::ftnParenthetical || ct == ScriptNodeType::ftnCharacter) {
       if (s.length() > 1 && s[0] == '~') {
         new_node(ScriptNodeType::ftnLyric);
-        append(s.substr(1));
-        continue;
-      } else {
-        append(s);
-        continue;
-      }
-    } else if (curr_node.type == ScriptNodeType::ftnLyric) {
-      if (s.length() > 1 && s[0] == '~') {
-        append(s.substr(1));
-        continue;
+        append(ws_ltrim_view(s.substr(1)));
+        return;
       } else {
         new_node(ScriptNodeType::ftnSpeech);
         append(s);
-        continue;
-      }
-    } else if (!nodes.empty()) {
-      ScriptNodeType ct = nodes.back().type;
-      if (ct == ScriptNodeType::ftnParenthetical || ct == ScriptNodeType::ftnCharacter) {
-        if (s.length() > 1 && s[0] == '~') {
-          new_node(ScriptNodeType::ftnLyric);
-          append(ws_ltrim(s.substr(1)));
-          continue;
-        } else {
-          new_node(ScriptNodeType::ftnSpeech);
-          append(s);
-          continue;
-        }
+        return;
       }
     }
+  }
 
-    // Character
-    if (curr_node.type == ScriptNodeType::ftnUnknown && isCharacter(s)) {
-      if (isDualDialog(s)) {
-        bool prev_dialog_modded = false;
-        for (std::size_t pos = nodes.size(); pos-- > 0;) {
-          if (nodes[pos].type == ScriptNodeType::ftnDialog) {
-            nodes[pos].type = ScriptNodeType::ftnDialogLeft;
-            prev_dialog_modded = true;
-            break;
-          }
-        }
-        if (prev_dialog_modded) {
-          new_node(ScriptNodeType::ftnDialogRight);
-        } else {
-          new_node(ScriptNodeType::ftnDialog);
+  // Character
+  if (curr_node.type == ScriptNodeType::ftnUnknown && isCharacter(s)) {
+    // paired with the previous dialog by indexDialogs()
+    new_node(ScriptNodeType::ftnDialog);
+    curr_node.dual = isDualDialog(s);
+    new_node(ScriptNodeType::ftnCharacter);
+    append(parseCharacter(s));
+    end_node();
+    return;
+  }
+
+  // Isolated Lyric
+  if (s.length() > 1 && s[0] == '~') {
+    new_node(ScriptNodeType::ftnLyric);
+    append(ws_ltrim_view(s.substr(1)));
+    end_node();
+    return;
+  }
+
+  // Section
+  if (!s.empty() && s[0] == '#') {
+    for (std::size_t i = 1; i < 6; ++i) {
+      if (s.length() > i && s[i] == '#') {
+        if (i == 5) {
+          new_node(ScriptNodeType::ftnSection, section_keys[i + 1]);
+          append(s.substr(i + 1));
+          state.section = i + 1;
+          break;
         }
-        new_node(ScriptNodeType::ftnCharacter);
-        append(parseCharacter(s));
-        end_node();
       } else {
-        new_node(ScriptNodeType::ftnDialog);
-        new_node(ScriptNodeType::ftnCharacter);
-        append(parseCharacter(s));
-        end_node();
+        new_node(ScriptNodeType::ftnSection, section_keys[i]);
+        append(s.substr(i));
+        state.section = i;
+        break;
       }
-      continue;
     }
+    end_node();
+    return;
+  }
 
-    // Isolated Lyric
-    if (s.length() > 1 && s[0] == '~') {
-      new_node(ScriptNodeType::ftnLyric);
-      append(ws_ltrim(s.substr(1)));
-      end_node();
-      continue;
-    }
+  // Synopsis
+  if (s.length() > 1 && s[0] == '=') {
+    new_node(ScriptNodeType::ftnSynopsis, section_keys[state.section]);
+    append(ws_trim_view(s.substr(1)));
+    end_node();
+    return;
+  }
 
-    // Section
-    if (!s.empty() && s[0] == '#') {
-      for (std::size_t i = 1; i < 6; ++i) {
-        if (s.length() > i && s[i] == '#') {
-          if (i == 5) {
-            new_node(ScriptNodeType::ftnSection, std::to_string(i + 1));
-            append(s.substr(i + 1));
-            currSection = i + 1;
-            break;
-          }
-        } else {
-          new_node(ScriptNodeType::ftnSection, std::to_string(i));
-          append(s.substr(i));
-          currSection = i;
-          break;
-        }
-      }
+  // Action
+  if (curr_node.type == ScriptNodeType::ftnAction) {
+    if (isCenter(s)) {
+      new_node(ScriptNodeType::ftnActionCenter);
+      append(ws_trim_view(s.substr(1, s.length() - 2)));
       end_node();
-      continue;
+    } else {
+      append(line);
     }
+    return;
+  }
+  if (isCenter(s)) {
+    new_node(ScriptNodeType::ftnActionCenter);
+    append(ws_trim_view(s.substr(1, s.length() - 2)));
+    end_node();
+    return;
+  }
+  if (s.length() > 1 && s[0] == '!') {
+    new_node(ScriptNodeType::ftnAction);
+    append(s.substr(1));
+    return;
+  }
+  if (curr_node.type == ScriptNodeType::ftnUnknown) {
+    new_node(ScriptNodeType::ftnAction);
+    append(line);
+    return;
+  }
+}
 
-    // Synopsis
-    if (s.length() > 1 && s[0] == '=') {
-      new_node(ScriptNodeType::ftnSynopsis, std::to_string(currSection));
-      append(ws_trim(s.substr(1)));
-      end_node();
-      continue;
+std::size_t Script::parseRange(
+    const std::string &text,
+    const std::size_t begin,
+    const std::size_t end,
+    ParseState &state
+) {
+  const StatsTimer timer(statParse);
+  std::size_t lines = 0;
+  LineReader reader(text, begin);
+  for (std::string_view line; reader.offset() != end && reader.next(line); ++lines) {
+    line_offset = reader.start();
+    parseLine(line, state);
+    if (line.empty() && reader.offset() != std::string::npos) {
+      checkpoints.push_back({ reader.offset(), nodes.size(), state.section });
     }
+  }
+  stats_count(statLines, lines);
+  return reader.unclosedBoneyard();
+}
 
-    // Action
-    if (curr_node.type == ScriptNodeType::ftnAction) {
-      if (isCenter(s)) {
-        new_node(ScriptNodeType::ftnActionCenter);
-        append(ws_trim(s.substr(1, s.length() - 2)));
-        end_node();
-      } else {
-        append(line);
+void Script::parseFountain(const std::string_view &text, const unsigned &threads) {
+  clear();
+  source.assign(text);
+  checkpoints.push_back({ 0, 0, 1 });
+  if (text.empty()) {
+    return;
+  }
+  stats_count(statBytes, text.length());
+
+  // determine whether to try to extract header
+  ParseState state{ hasHeader(text), 1 };
+
+  std::vector<std::size_t> splits;
+  if (threads > 1) {
+    splits = splitPoints(source, std::max(source.length() / threads, parallel_chunk));
+  }
+  if (splits.empty()) {
+    const StatsTimer timer(statParse);
+    open_boneyard = parseRange(source, 0, std::string::npos, state);
+    end_node();
+    indexNodes();
+    stats_count_nodes(*this);
+    return;
+  }
+
+  // parse each range concurrently; the section in effect at the start of a range is not
+  // known until the ranges before it are parsed, so it starts as 0
+  splits.push_back(std::string::npos);
+  std::vector<Script> parts(splits.size() - 1);
+  std::vector<ParseState> states(parts.size(), ParseState{ false, 0 });
+  std::vector<std::size_t> unclosed(parts.size());
+  std::vector<std::thread> workers;
+  for (std::size_t i = 0; i < parts.size(); ++i) {
+    workers.emplace_back([&, i]() {
+      unclosed[i] = parts[i].parseRange(source, splits[i], splits[i + 1], states[i]);
+      parts[i].end_node();
+    });
+  }
+  open_boneyard = parseRange(source, 0, splits[0], state);
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  const StatsTimer timer(statParse);
+
+  // join the ranges, resolving synopses that precede the first section of their range
+  for (std::size_t i = 0; i < parts.size(); ++i) {
+    const std::string synopsis_key = std::to_string(state.section);
+    const std::size_t base = nodes.size();
+    for (auto &node : parts[i].nodes) {
+      if (node.type == ScriptNodeType::ftnSynopsis && node.key == "0") {
+        node.key = synopsis_key;
       }
-      continue;
     }
-    if (isCenter(s)) {
-      new_node(ScriptNodeType::ftnActionCenter);
-      append(ws_trim(s.substr(1, s.length() - 2)));
-      end_node();
+    nodes.insert(
+        nodes.end(),
+        std::make_move_iterator(parts[i].nodes.begin()),
+        std::make_move_iterator(parts[i].nodes.end())
+    );
+    for (const auto &cp : parts[i].checkpoints) {
+      const int section = cp.section ? cp.section : state.section;
+      checkpoints.push_back({ cp.offset, cp.node + base, section });
+    }
+    if (states[i].section) {
+      state.section = states[i].section;
+    }
+    open_boneyard = std::min(open_boneyard, unclosed[i]);
+  }
+
+  indexNodes();
+  stats_count_nodes(*this);
+}
+
+void Script::applyEdit(
+    const std::size_t offset,
+    const std::size_t removed_len,
+    const std::string &inserted_text
+) {
+  if (offset > source.length()) {
+    return;
+  }
+  const std::size_t removed = std::min(removed_len, source.length() - offset);
+  source.replace(offset, removed, inserted_text);
+  if (checkpoints.empty() || source.empty()) {
+    std::string text = std::move(source);
+    parseFountain(text);
+    return;
+  }
+
+  // old and new ends of the edited range
+  const std::size_t old_end = offset + removed;
+  const std::size_t new_end = offset + inserted_text.length();
+
+  // resume from the last checkpoint before the edit, or before unterminated boneyard that
+  // the edit might close
+  auto start = std::upper_bound(
+      checkpoints.begin(),
+      checkpoints.end(),
+      std::min(offset, open_boneyard),
+      [](const std::size_t value, const Checkpoint &cp) { return value < cp.offset; }
+  );
+  --start;
+  const Checkpoint resume = *start;
+  std::vector<Checkpoint> old_checkpoints(start + 1, checkpoints.end());
+  checkpoints.erase(start + 1, checkpoints.end());
+
+  std::vector<ScriptNode> old_nodes(
+      std::make_move_iterator(nodes.begin() + resume.node), std::make_move_iterator(nodes.end())
+  );
+  nodes.resize(resume.node);
+  curr_node.clear();
+  if (resume.offset == 0) {
+    metadata.clear();
+  }
+
+  ParseState state{ resume.offset == 0 && hasHeader(source), resume.section };
+
+  LineReader reader(source, resume.offset);
+  auto old_cp = old_checkpoints.cbegin();
+  for (std::string_view line; reader.next(line);) {
+    line_offset = reader.start();
+    parseLine(line, state);
+    if (!line.empty() || reader.offset() == std::string::npos) {
       continue;
     }
-    if (s.length() > 1 && s[0] == '!') {
-      new_node(ScriptNodeType::ftnAction);
-      append(s.substr(1));
+    const Checkpoint cp{ reader.offset(), nodes.size(), state.section };
+    checkpoints.push_back(cp);
+    if (cp.offset < new_end) {
       continue;
     }
-    if (curr_node.type == ScriptNodeType::ftnUnknown) {
-      new_node(ScriptNodeType::ftnAction);
-      append(line);
+
+    // rejoin the old parse where it reached the same text in the same state
+    const std::size_t old_offset = cp.offset - new_end + old_end;
+    while (old_cp != old_checkpoints.cend() && old_cp->offset < old_offset) {
+      ++old_cp;
+    }
+    if (old_cp == old_checkpoints.cend() || old_cp->offset != old_offset ||
+        old_cp->section != cp.section) {
       continue;
     }
+
+    const std::size_t old_count = old_cp->node - resume.node;
+    for (auto node = old_nodes.begin() + old_count; node != old_nodes.end(); ++node) {
+      node->offset = node->offset - old_end + new_end;
+    }
+
+    nodes.insert(
+        nodes.end(),
+        std::make_move_iterator(old_nodes.begin() + old_count),
+        std::make_move_iterator(old_nodes.end())
+    );
+    for (++old_cp; old_cp != old_checkpoints.cend(); ++old_cp) {
+      checkpoints.push_back({ old_cp->offset - old_end + new_end,
+                              old_cp->node - old_count - resume.node + cp.node,
+                              old_cp->section });
+    }
+    if (reader.unclosedBoneyard() != std::string::npos) {
+      open_boneyard = reader.unclosedBoneyard();
+    } else if (open_boneyard != std::string::npos && open_boneyard >= old_offset) {
+      open_boneyard = open_boneyard - old_end + new_end;
+    } else if (open_boneyard != std::string::npos) {
+      // any later "/*" is also unterminated
+      open_boneyard = source.find("/*", cp.offset);
+    }
+    indexNodes();
+    return;
   }
 
   end_node();
+  open_boneyard = reader.unclosedBoneyard();
+  indexNodes();
+}
+
+StreamParser::StreamParser(NodeCallback on_node) : on_node(std::move(on_node)) {}
+
+void StreamParser::feed(const std::string_view &chunk) {
+  buffer.append(chunk);
+  if (buffer.find(wait_for, search_from) == std::string::npos) {
+    search_from = buffer.empty() ? 0 : buffer.length() - 1;
+    return;
+  }
+  parseLines(false);
+  pairDialog();
+  emitNodes(false);
+}
+
+void StreamParser::finish() {
+  if (header_checked || !buffer.empty()) {
+    parseLines(true);
+    script.end_node();
+  }
+  pairDialog();
+  emitNodes(true);
+}
+
+void StreamParser::parseLines(const bool last) {
+  if (!header_checked) {
+    state.has_header = hasHeader(buffer);
+    header_checked = true;
+  }
+
+  LineReader reader(buffer, resume);
+  std::size_t done = resume;
+  for (std::string_view line; reader.next(line);) {
+    // a line may still change if it is unterminated or has boneyard that is not yet closed
+    if (!last && reader.offset() == std::string::npos) {
+      wait_for = "\n";
+      break;
+    }
+    if (!last && reader.unclosedBoneyard() != std::string::npos) {
+      wait_for = "*/";
+      break;
+    }
+    script.line_offset = consumed + reader.start();
+    script.parseLine(line, state);
+    done = reader.offset();
+  }
+  if (last) {
+    return;
+  }
+
+  // keep the newline before the next line so reading resumes at a line start
+  if (done > 1) {
+    buffer.erase(0, done - 1);
+    consumed += done - 1;
+    done = 1;
+  }
+  resume = done;
+  search_from = buffer.empty() ? 0 : buffer.length() - 1;
+}
+
+// Pairs each dialog marked with ^ with the dialog block just before it.
+void StreamParser::pairDialog() {
+  constexpr auto dialog_block = ScriptNodeType::ftnCharacter |
+                                ScriptNodeType::ftnParenthetical | ScriptNodeType::ftnSpeech |
+                                ScriptNodeType::ftnLyric | ScriptNodeType::ftnBlankLine |
+                                ScriptNodeType::ftnContinuation;
+
+  auto &nodes = script.nodes;
+  for (; scanned < nodes.size(); ++scanned) {
+    ScriptNode &node = nodes[scanned];
+    if (isDialogMarker(node)) {
+      if (node.dual && held != std::string::npos) {
+        nodes[held].type = ScriptNodeType::ftnDialogLeft;
+        node.type = ScriptNodeType::ftnDialogRight;
+        held = std::string::npos;
+      } else {
+        node.type = ScriptNodeType::ftnDialog;
+        held = scanned;
+      }
+    } else if (!(node.type & dialog_block)) {
+      held = std::string::npos;
+    }
+  }
+}
+
+void StreamParser::emitNodes(const bool last) {
+  auto &nodes = script.nodes;
+  const std::size_t end = (last || held == std::string::npos) ? nodes.size() : held;
+  for (std::size_t pos = emitted; pos < end; ++pos) {
+    on_node(nodes[pos]);
+  }
+
+  // the parser consults the last node when classifying the next line
+  const std::size_t drop = (end == nodes.size() && end > 0) ? end - 1 : end;
+  nodes.erase(nodes.begin(), nodes.begin() + drop);
+  emitted = end - drop;
+  scanned -= drop;
+  if (held != std::string::npos) {
+    held -= drop;
+  }
+}
+
+void parseFountain(std::istream &in, const StreamParser::NodeCallback &on_node) {
+  StreamParser parser(on_node);
+  std::string chunk(64 * 1024, '\0');
+  while (in.read(chunk.data(), chunk.length()) || in.gcount() > 0) {
+    parser.feed(std::string_view(chunk.data(), in.gcount()));
+  }
+  parser.finish();
 }
 
 }  // namespace Fountain
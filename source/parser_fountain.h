@@ -4,11 +4,69 @@
 #pragma once
 
 #include "model_script.h"
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <map>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace Fountain {
 
 // Parse a Fountain-formatted screenplay into the given Script object.
 void parseFountain(Script &script, const std::string &text);
 
+// Adds transitions and scene heading prefixes recognized along with the English ones, such
+// as "FONDU AU NOIR:" or "EXTÉRIEUR".  Transitions match whole uppercase lines, and prefixes
+// match when followed by "." or a space, ignoring ASCII case.  Call before parsing starts.
+// Returns false if a word is empty, longer than 32 bytes, or does not fit in the table.
+bool addTransitions(const std::vector<std::string> &words);
+bool addScenePrefixes(const std::vector<std::string> &words);
+
+// Parses Fountain text that arrives in chunks.  Each node is passed to on_node as soon as it
+// is complete, so only unparsed text and the current dialog block are held in memory.
+// Boneyard is held until its closing "*/" arrives, and a dialog marked with ^ is paired only
+// with the dialog block just before it.  Use Script to keep the whole document.
+class StreamParser {
+ public:
+  using NodeCallback = std::function<void(const ScriptNode &)>;
+
+  explicit StreamParser(NodeCallback on_node);
+
+  // Parses the complete lines available after appending chunk.
+  void feed(const std::string_view &chunk);
+
+  // Parses the remaining text.  Call once after the last chunk.
+  void finish();
+
+  // Title page keys and values read so far
+  const std::map<std::string, std::string> &metadata() const {
+    return script.metadata;
+  }
+
+ private:
+  void parseLines(const bool last);
+  void pairDialog();
+  void emitNodes(const bool last);
+
+  NodeCallback on_node;
+  Script script;  // parser state and nodes not yet passed on
+  Script::ParseState state;
+  bool header_checked = false;
+
+  std::string buffer;        // unparsed text, after the newline ending the last line parsed
+  std::size_t consumed = 0;  // text dropped from the front of buffer
+  std::size_t resume = 0;
+  std::string_view wait_for = "\n";  // text that must arrive before parsing can continue
+  std::size_t search_from = 0;
+
+  std::size_t emitted = 0;  // leading nodes already passed on
+  std::size_t scanned = 0;  // nodes checked for dialog pairing
+  std::size_t held = std::string::npos;  // unpaired dialog that a ^ dialog may still join
+};
+
+// Reads Fountain text from in, passing each node to on_node as soon as it is complete.
+void parseFountain(std::istream &in, const StreamParser::NodeCallback &on_node);
+
 }  // namespace Fountain
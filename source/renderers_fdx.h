@@ -2,8 +2,20 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #pragma once
+#include <ostream>
 #include <string>
+#include <string_view>
+
+#include "model_script.h"
 
 namespace Fountain {
-std::string ftn2fdx(const std::string &input);
+std::string ftn2fdx(const std::string_view &input);
+
+// Write the document to out as it is rendered.
+void ftn2fdx(std::ostream &out, const std::string_view &input);
+
+// Render a script that is already parsed.  A const Script may be rendered by several threads
+// at once.
+std::string ftn2fdx(const Script &script);
+void ftn2fdx(std::ostream &out, const Script &script);
 }
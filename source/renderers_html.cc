@@ -3,115 +3,145 @@
 
 #include "renderers_html.h"
 
-#include <regex>
+#include <ostream>
 #include <string>
+#include <string_view>
 
 #include "model_script.h"
 #include "parser_fountain.h"
-#include "utils_file.h"
-#include "utils_string.h"
+#include "renderers_markup.h"
 
 namespace Fountain {
 
-std::string
-ftn2html(const std::string &input, const std::string &css_fn, const bool &embed_css) {
-  std::string output{ "<!DOCTYPE html>\n<html>\n<head>\n" };
+namespace {
+
+const TagTable html_tags{
+  { "<Fountain>", R"(<div class="Fountain">)" },
+  { "</Fountain>", "</div>" },
+  { "<Transition>", R"(<div class="Transition">)" },
+  { "</Transition>", "</div>" },
+  { "<SceneHeader>", R"(<div class="SceneHeader">)" },
+  { "</SceneHeader>", "</div>" },
+  { "<Action>", R"(<div class="Action">)" },
+  { "</Action>", "</div>" },
+  { "<Lyric>", R"(<div class="Lyric">)" },
+  { "</Lyric>", "</div>" },
+  { "<Character>", R"(<div class="Character">)" },
+  { "</Character>", "</div>" },
+  { "<Parenthetical>", R"(<div class="Parenthetical">)" },
+  { "</Parenthetical>", "</div>" },
+  { "<Speech>", R"(<div class="Speech">)" },
+  { "</Speech>", "</div>" },
+  { "<Dialog>", R"(<div class="Dialog">)" },
+  { "</Dialog>", "</div>" },
+  { "<DialogDual>", R"(<div class="DialogDual">)" },
+  { "</DialogDual>", "</div>" },
+  { "<DialogLeft>", R"(<div class="DialogLeft">)" },
+  { "</DialogLeft>", "</div>" },
+  { "<DialogRight>", R"(<div class="DialogRight">)" },
+  { "</DialogRight>", "</div>" },
+  { "<PageBreak>", R"(<div class="PageBreak">)" },
+  { "</PageBreak>", "</div>" },
+  { "<Note>", R"(<div class="Note">)" },
+  { "</Note>", "</div>" },
+  { "<ActionCenter>", R"(<center>)" },
+  { "</ActionCenter>", "</center>" },
+  { "<BlankLine>", "" },
+  { "</BlankLine>", "" },
+  { "<SectionH1>", R"(<div class="SectionH1">)" },
+  { "</SectionH1>", "</div>" },
+  { "<SectionH2>", R"(<div class="SectionH2">)" },
+  { "</SectionH2>", "</div>" },
+  { "<SectionH3>", R"(<div class="SectionH3">)" },
+  { "</SectionH3>", "</div>" },
+  { "<SectionH4>", R"(<div class="SectionH4">)" },
+  { "</SectionH4>", "</div>" },
+  { "<SectionH5>", R"(<div class="SectionH5">)" },
+  { "</SectionH5>", "</div>" },
+  { "<SectionH6>", R"(<div class="SectionH6">)" },
+  { "</SectionH6>", "</div>" },
+  { "<SynopsisH1>", R"(<div class="SynopsisH1">)" },
+  { "</SynopsisH1>", "</div>" },
+  { "<SynopsisH2>", R"(<div class="SynopsisH2">)" },
+  { "</SynopsisH2>", "</div>" },
+  { "<SynopsisH3>", R"(<div class="SynopsisH3">)" },
+  { "</SynopsisH3>", "</div>" },
+  { "<SynopsisH4>", R"(<div class="SynopsisH4">)" },
+  { "</SynopsisH4>", "</div>" },
+  { "<SynopsisH5>", R"(<div class="SynopsisH5">)" },
+  { "</SynopsisH5>", "</div>" },
+  { "<SynopsisH6>", R"(<div class="SynopsisH6">)" },
+  { "</SynopsisH6>", "</div>" },
+};
+
+void writeDocument(
+    MarkupWriter &writer,
+    const Script &script,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  writer.write("<!DOCTYPE html>\n<html>\n<head>\n");
   if (!css_fn.empty()) {
     if (embed_css) {
-      std::string css_contents = file_get_contents(css_fn);
-      output += "<style type='text/css'>\n";
-      output += css_contents;
-      output += "\n</style>\n";
+      std::string css_contents = stylesheet_contents(css_fn);
+      writer.write("<style type='text/css'>\n");
+      writer.write(css_contents);
+      writer.write("\n</style>\n");
     } else {
-      output += R"(<link rel="stylesheet" type="text/css" href=")";
-      output += ((css_fn[0] == '/') ? "file://" : "") + css_fn;
-      output += "'>\n";
+      writer.write(R"(<link rel="stylesheet" type="text/css" href=")");
+      writer.write(((css_fn[0] == '/') ? "file://" : "") + css_fn);
+      writer.write("'>\n");
     }
   }
 
-  output +=
+  writer.write(
       "</head>\n<body>\n"
-      "<div id=\"wrapper\" class=\"fountain\">\n";
-
-  Fountain::Script script;
-  script.parseFountain(input);
+      "<div id=\"wrapper\" class=\"fountain\">\n"
+  );
 
-  output += script.to_string(
+  writer.write(
+      script,
       Fountain::ScriptNodeType::ftnContinuation | Fountain::ScriptNodeType::ftnKeyValue |
-      Fountain::ScriptNodeType::ftnUnknown
+          Fountain::ScriptNodeType::ftnUnknown
   );
 
-  output += "\n</div>\n</body>\n</html>\n";
-
-  try {
-    replace_all_inplace(output, "<Fountain>", R"(<div class="Fountain">)");
-    replace_all_inplace(output, "</Fountain>", "</div>");
-
-    replace_all_inplace(output, "<Transition>", R"(<div class="Transition">)");
-    replace_all_inplace(output, "</Transition>", "</div>");
-
-    replace_all_inplace(output, "<SceneHeader>", R"(<div class="SceneHeader">)");
-    replace_all_inplace(output, "</SceneHeader>", "</div>");
-
-    replace_all_inplace(output, "<Action>", R"(<div class="Action">)");
-    replace_all_inplace(output, "</Action>", "</div>");
-
-    replace_all_inplace(output, "<Lyric>", R"(<div class="Lyric">)");
-    replace_all_inplace(output, "</Lyric>", "</div>");
-
-    replace_all_inplace(output, "<Character>", R"(<div class="Character">)");
-    replace_all_inplace(output, "</Character>", "</div>");
-
-    replace_all_inplace(output, "<Parenthetical>", R"(<div class="Parenthetical">)");
-    replace_all_inplace(output, "</Parenthetical>", "</div>");
-
-    replace_all_inplace(output, "<Speech>", R"(<div class="Speech">)");
-    replace_all_inplace(output, "</Speech>", "</div>");
-
-    replace_all_inplace(output, "<Dialog>", R"(<div class="Dialog">)");
-    replace_all_inplace(output, "</Dialog>", "</div>");
-
-    replace_all_inplace(output, "<DialogDual>", R"(<div class="DialogDual">)");
-    replace_all_inplace(output, "</DialogDual>", "</div>");
-
-    replace_all_inplace(output, "<DialogLeft>", R"(<div class="DialogLeft">)");
-    replace_all_inplace(output, "</DialogLeft>", "</div>");
-
-    replace_all_inplace(output, "<DialogRight>", R"(<div class="DialogRight">)");
-    replace_all_inplace(output, "</DialogRight>", "</div>");
-
-    replace_all_inplace(output, "<PageBreak>", R"(<div class="PageBreak">)");
-    replace_all_inplace(output, "</PageBreak>", "</div>");
-
-    replace_all_inplace(output, "<Note>", R"(<div class="Note">)");
-    replace_all_inplace(output, "</Note>", "</div>");
-
-    replace_all_inplace(output, "<ActionCenter>", R"(<center>)");
-    replace_all_inplace(output, "</ActionCenter>", "</center>");
-
-    replace_all_inplace(output, "<BlankLine>", "");
-    replace_all_inplace(output, "</BlankLine>", "");
+  writer.write("\n</div>\n</body>\n</html>\n");
+}
 
-    for (std::size_t i = 1; i <= 6; i++) {
-      std::string lvl = std::to_string(i);
-      replace_all_inplace(
-          output, "<SectionH" + lvl + ">", R"(<div class="SectionH)" + lvl + R"(">)"
-      );
-      replace_all_inplace(output, "</SectionH" + lvl + ">", "</div>");
+}  // namespace
 
-      replace_all_inplace(
-          output, "<SynopsisH" + lvl + ">", R"(<div class="SynopsisH)" + lvl + R"(">)"
-      );
-      replace_all_inplace(output, "</SynopsisH" + lvl + ">", "</div>");
-    }
+std::string ftn2html(
+    const std::string_view &input,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  return ftn2html(Script(input), css_fn, embed_css);
+}
 
-    static const std::regex re_newlines(R"(\n+)");
-    output = std::regex_replace(output, re_newlines, "\n");
-  } catch (std::regex_error &e) {
-    print_regex_error(e, __FILE__, __LINE__);
-  }
+void ftn2html(
+    std::ostream &out,
+    const std::string_view &input,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  ftn2html(out, Script(input), css_fn, embed_css);
+}
 
+std::string ftn2html(const Script &script, const std::string &css_fn, const bool &embed_css) {
+  std::string output;
+  MarkupWriter writer(output, html_tags);
+  writeDocument(writer, script, css_fn, embed_css);
   return output;
 }
 
+void ftn2html(
+    std::ostream &out,
+    const Script &script,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  MarkupWriter writer(out, html_tags);
+  writeDocument(writer, script, css_fn, embed_css);
+}
+
 }  // namespace Fountain
@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: Copyright 2021-2025 xiota
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "renderers_markup.h"
+
+#include <algorithm>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "config.h"
+#include "model_script.h"
+#include "stylesheets.h"
+#include "utils_file.h"
+#include "utils_stats.h"
+
+namespace Fountain {
+
+MarkupWriter::MarkupWriter(std::string &output, const TagTable &tags)
+    : output(output), tags(tags) {
+  for (const auto &tag : tags) {
+    max_tag = std::max(max_tag, tag.first.length());
+  }
+  newline = !output.empty() && output.back() == '\n';
+}
+
+MarkupWriter::MarkupWriter(std::ostream &out, const TagTable &tags)
+    : MarkupWriter(buffer, tags) {
+  stream = &out;
+  buffer.reserve(chunk_size + max_tag);
+}
+
+MarkupWriter::~MarkupWriter() {
+  flush();
+}
+
+void MarkupWriter::flush() {
+  if (stream && !output.empty()) {
+    const StatsTimer timer(statWrite);
+    stream->write(output.data(), output.length());
+    stream->flush();
+    output.clear();
+  }
+}
+
+void MarkupWriter::write(const std::string_view &text) {
+  std::size_t pos = 0;
+  while (pos < text.length()) {
+    std::size_t next = text.find_first_of("<\n", pos);
+    if (next == std::string_view::npos) {
+      next = text.length();
+    }
+    if (next > pos) {
+      output.append(text, pos, next - pos);
+      newline = false;
+      pos = next;
+      continue;
+    }
+
+    if (text[pos] == '\n') {
+      if (!newline) {
+        output += '\n';
+        newline = true;
+      }
+      ++pos;
+      continue;
+    }
+
+    // only tags short enough to be in the table need a lookup
+    std::size_t close = text.substr(pos, max_tag).find('>');
+    if (close != std::string_view::npos) {
+      auto tag = tags.find(text.substr(pos, close + 1));
+      if (tag != tags.end()) {
+        if (!tag->second.empty()) {
+          output += tag->second;
+          newline = false;
+        }
+        pos += close + 1;
+        continue;
+      }
+    }
+    output += '<';
+    newline = false;
+    ++pos;
+  }
+
+  if (stream && output.length() >= chunk_size) {
+    flush();
+  }
+}
+
+void MarkupWriter::write(const Script &script, const int &flags) {
+  const StatsTimer timer(statRender);
+  write("<Fountain>\n");
+  script.render([this](const std::string &text) { write(text); }, flags);
+  write("\n</Fountain>\n");
+}
+
+std::string_view bundled_stylesheet(const std::string_view &type) {
+  for (const auto &stylesheet : bundled::stylesheets) {
+    if (stylesheet.type == type) {
+      return stylesheet.contents;
+    }
+  }
+  return {};
+}
+
+std::string stylesheet_contents(const std::string &css_fn) {
+  const std::string_view path = CSS_PATH "/";
+  if (css_fn.compare(0, path.length(), path) == 0) {
+    for (const auto &stylesheet : bundled::stylesheets) {
+      if (std::string_view(css_fn).substr(path.length()) == stylesheet.name) {
+        return std::string(stylesheet.contents);
+      }
+    }
+  }
+  return file_get_cached(css_fn);
+}
+
+}  // namespace Fountain
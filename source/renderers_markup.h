@@ -0,0 +1,54 @@
+// SPDX-FileCopyrightText: Copyright 2021-2025 xiota
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "model_script.h"
+
+namespace Fountain {
+
+// Markup that replaces each tag produced by ScriptNode::to_string().
+// Tags missing from the table are written unchanged.
+using TagTable = std::unordered_map<std::string_view, std::string_view>;
+
+// Appends text to output in a single pass, translating tags and collapsing runs of newlines.
+// When writing to a stream, output is buffered and flushed in chunks.
+class MarkupWriter {
+ public:
+  MarkupWriter(std::string &output, const TagTable &tags);
+  MarkupWriter(std::ostream &out, const TagTable &tags);
+  ~MarkupWriter();
+
+  MarkupWriter(const MarkupWriter &) = delete;
+  MarkupWriter &operator=(const MarkupWriter &) = delete;
+
+  void write(const std::string_view &text);
+  void write(const Script &script, const int &flags = ScriptNodeType::ftnNone);
+  void flush();
+
+ private:
+  static constexpr std::size_t chunk_size = 64 * 1024;
+
+  std::string buffer;  // output when writing to a stream
+  std::string &output;
+  std::ostream *stream = nullptr;
+  const TagTable &tags;
+  std::size_t max_tag = 0;
+  bool newline = false;
+};
+
+// Contents of the stylesheet bundled for an output type (html, xml, screenplain or textplay),
+// or an empty view if the type has none.
+std::string_view bundled_stylesheet(const std::string_view &type);
+
+// Contents of the stylesheet css_fn, for embedding in output.  Bundled stylesheets named by
+// their installed path are taken from the library without reading the file.
+std::string stylesheet_contents(const std::string &css_fn);
+
+}  // namespace Fountain
@@ -10,6 +10,7 @@
 #  include <cstddef>
 #  include <map>
 #  include <string>
+#  include <string_view>
 #  include <tuple>
 #  include <vector>
 
@@ -17,6 +18,7 @@
 
 #  include "model_script.h"
 #  include "parser_fountain.h"
+#  include "utils_stats.h"
 #  include "utils_string.h"
 
 #  if (PODOFO_VERSION_MINOR < 10) && (PODOFO_VERSION_MAJOR < 1)
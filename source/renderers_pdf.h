@@ -3,12 +3,18 @@
 
 #pragma once
 #include <string>
+#include <string_view>
+
+#include "model_script.h"
 
 namespace Fountain {
 
 // Generate a PDF from Fountain input and write it to fn.
 // Returns true on success, false on failure.
 // Only compiled if HAVE_PODOFO is defined.
-bool ftn2pdf(const std::string &fn, const std::string &input);
+bool ftn2pdf(const std::string &fn, const std::string_view &input);
+
+// Render a script that is already parsed.
+bool ftn2pdf(const std::string &fn, const Script &script);
 
 }  // namespace Fountain
@@ -3,100 +3,124 @@
 
 #include "renderers_screenplain.h"
 
-#include <regex>
+#include <ostream>
 #include <string>
+#include <string_view>
 
 #include "model_script.h"
 #include "parser_fountain.h"
-#include "utils_file.h"
-#include "utils_string.h"
+#include "renderers_markup.h"
 
 namespace Fountain {
 
-std::string
-ftn2screenplain(const std::string &input, const std::string &css_fn, const bool &embed_css) {
-  std::string output{ "<!DOCTYPE html>\n<html>\n<head>\n" };
+namespace {
+
+const TagTable screenplain_tags{
+  { "<Transition>", R"(<div class="transition">)" },
+  { "</Transition>", "</div>" },
+  { "<SceneHeader>", R"(<h6 class="sceneheader">)" },
+  { "</SceneHeader>", "</h6>" },
+  { "<Action>", R"(<div class="action">)" },
+  { "</Action>", "</div>" },
+  { "<Lyric>", R"(<div class="lyric">)" },
+  { "</Lyric>", "</div>" },
+  { "<Character>", R"(<p class="character">)" },
+  { "</Character>", "</p>" },
+  { "<Parenthetical>", R"(<p class="parenthetical">)" },
+  { "</Parenthetical>", "</p>" },
+  { "<Speech>", R"(<p class="speech">)" },
+  { "</Speech>", "</p>" },
+  { "<Dialog>", R"(<div class="dialog">)" },
+  { "</Dialog>", "</div>" },
+  { "<DialogDual>", R"(<div class="dual">)" },
+  { "</DialogDual>", "</div>" },
+  { "<DialogLeft>", R"(<div class="left">)" },
+  { "</DialogLeft>", "</div>" },
+  { "<DialogRight>", R"(<div class="right">)" },
+  { "</DialogRight>", "</div>" },
+  { "<PageBreak>", R"(<div class="page-break">)" },
+  { "</PageBreak>", "</div>" },
+  { "<Note>", R"(<div class="note">)" },
+  { "</Note>", "</div>" },
+  { "<ActionCenter>", R"(<center>)" },
+  { "</ActionCenter>", "</center>" },
+  { "<BlankLine>", "" },
+  { "</BlankLine>", "" },
+};
+
+void writeDocument(
+    MarkupWriter &writer,
+    const Script &script,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  writer.write("<!DOCTYPE html>\n<html>\n<head>\n");
 
   if (!css_fn.empty()) {
     if (embed_css) {
-      std::string css_contents = file_get_contents(css_fn);
-      output += "<style type='text/css'>\n";
-      output += css_contents;
-      output += "\n</style>\n";
+      std::string css_contents = stylesheet_contents(css_fn);
+      writer.write("<style type='text/css'>\n");
+      writer.write(css_contents);
+      writer.write("\n</style>\n");
     } else {
-      output += R"(<link rel="stylesheet" type="text/css" href=")";
-      output += ((css_fn[0] == '/') ? "file://" : "") + css_fn;
-      output += "'>\n";
+      writer.write(R"(<link rel="stylesheet" type="text/css" href=")");
+      writer.write(((css_fn[0] == '/') ? "file://" : "") + css_fn);
+      writer.write("'>\n");
     }
   }
 
-  output +=
+  writer.write(
       "</head>\n<body>\n"
-      "<div id=\"wrapper\" class=\"fountain\">\n";
-
-  Fountain::Script script;
-  script.parseFountain(input);
+      "<div id=\"wrapper\" class=\"fountain\">\n"
+  );
 
-  output += script.to_string(
+  writer.write(
+      script,
       Fountain::ScriptNodeType::ftnContinuation | Fountain::ScriptNodeType::ftnKeyValue |
-      Fountain::ScriptNodeType::ftnUnknown
+          Fountain::ScriptNodeType::ftnUnknown
   );
 
-  output += "\n</div>\n</body>\n</html>\n";
-
-  try {
-    replace_all_inplace(output, "<Transition>", R"(<div class="transition">)");
-    replace_all_inplace(output, "</Transition>", "</div>");
-
-    replace_all_inplace(output, "<SceneHeader>", R"(<h6 class="sceneheader">)");
-    replace_all_inplace(output, "</SceneHeader>", "</h6>");
-
-    replace_all_inplace(output, "<Action>", R"(<div class="action">)");
-    replace_all_inplace(output, "</Action>", "</div>");
-
-    replace_all_inplace(output, "<Lyric>", R"(<div class="lyric">)");
-    replace_all_inplace(output, "</Lyric>", "</div>");
-
-    replace_all_inplace(output, "<Character>", R"(<p class="character">)");
-    replace_all_inplace(output, "</Character>", "</p>");
-
-    replace_all_inplace(output, "<Parenthetical>", R"(<p class="parenthetical">)");
-    replace_all_inplace(output, "</Parenthetical>", "</p>");
-
-    replace_all_inplace(output, "<Speech>", R"(<p class="speech">)");
-    replace_all_inplace(output, "</Speech>", "</p>");
-
-    replace_all_inplace(output, "<Dialog>", R"(<div class="dialog">)");
-    replace_all_inplace(output, "</Dialog>", "</div>");
-
-    replace_all_inplace(output, "<DialogDual>", R"(<div class="dual">)");
-    replace_all_inplace(output, "</DialogDual>", "</div>");
-
-    replace_all_inplace(output, "<DialogLeft>", R"(<div class="left">)");
-    replace_all_inplace(output, "</DialogLeft>", "</div>");
-
-    replace_all_inplace(output, "<DialogRight>", R"(<div class="right">)");
-    replace_all_inplace(output, "</DialogRight>", "</div>");
-
-    replace_all_inplace(output, "<PageBreak>", R"(<div class="page-break">)");
-    replace_all_inplace(output, "</PageBreak>", "</div>");
-
-    replace_all_inplace(output, "<Note>", R"(<div class="note">)");
-    replace_all_inplace(output, "</Note>", "</div>");
+  writer.write("\n</div>\n</body>\n</html>\n");
+}
 
-    replace_all_inplace(output, "<ActionCenter>", R"(<center>)");
-    replace_all_inplace(output, "</ActionCenter>", "</center>");
+}  // namespace
 
-    replace_all_inplace(output, "<BlankLine>", "");
-    replace_all_inplace(output, "</BlankLine>", "");
+std::string ftn2screenplain(
+    const std::string_view &input,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  return ftn2screenplain(Script(input), css_fn, embed_css);
+}
 
-    static const std::regex re_newlines(R"(\n+)");
-    output = std::regex_replace(output, re_newlines, "\n");
-  } catch (std::regex_error &e) {
-    print_regex_error(e, __FILE__, __LINE__);
-  }
+void ftn2screenplain(
+    std::ostream &out,
+    const std::string_view &input,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  ftn2screenplain(out, Script(input), css_fn, embed_css);
+}
 
+std::string ftn2screenplain(
+    const Script &script,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  std::string output;
+  MarkupWriter writer(output, screenplain_tags);
+  writeDocument(writer, script, css_fn, embed_css);
   return output;
 }
 
+void ftn2screenplain(
+    std::ostream &out,
+    const Script &script,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  MarkupWriter writer(out, screenplain_tags);
+  writeDocument(writer, script, css_fn, embed_css);
+}
+
 }  // namespace Fountain
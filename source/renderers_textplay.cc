@@ -3,100 +3,123 @@
 
 #include "renderers_textplay.h"
 
-#include <regex>
+#include <ostream>
 #include <string>
+#include <string_view>
 
 #include "model_script.h"
 #include "parser_fountain.h"
-#include "utils_file.h"
-#include "utils_string.h"
+#include "renderers_markup.h"
 
 namespace Fountain {
 
-std::string
-ftn2textplay(const std::string &input, const std::string &css_fn, const bool &embed_css) {
-  std::string output{ "<!DOCTYPE html>\n<html>\n<head>\n" };
+namespace {
+
+const TagTable textplay_tags{
+  { "<Transition>", R"(<h3 class="right-transition">)" },
+  { "</Transition>", "</h3>" },
+  { "<SceneHeader>", R"(<h2 class="full-slugline">)" },
+  { "</SceneHeader>", "</h2>" },
+  { "<Action>", R"(<p class="action">)" },
+  { "</Action>", "</p>" },
+  { "<Lyric>", R"(<span class="lyric">)" },
+  { "</Lyric>", "</span>" },
+  { "<Character>", R"(<dt class="character">)" },
+  { "</Character>", "</dt>" },
+  { "<Parenthetical>", R"(<dd class="parenthetical">)" },
+  { "</Parenthetical>", "</dd>" },
+  { "<Speech>", R"(<dd class="dialogue">)" },
+  { "</Speech>", "</dd>" },
+  { "<Dialog>", R"(<div class="dialog">)" },
+  { "</Dialog>", "</div>" },
+  { "<DialogDual>", R"(<div class="dialog_wrapper">)" },
+  { "</DialogDual>", "</div>" },
+  { "<DialogLeft>", R"(<dl class="first">)" },
+  { "</DialogLeft>", "</dl>" },
+  { "<DialogRight>", R"(<dl class="second">)" },
+  { "</DialogRight>", "</dl>" },
+  { "</PageBreak>", R"(<div class="page-break">)" },
+  { "<Note>", R"(<p class="comment">)" },
+  { "</Note>", "</p>" },
+  { "<BlankLine>", "" },
+  { "</BlankLine>", "" },
+  { "<ActionCenter>", R"(<p class="center">)" },
+  { "</ActionCenter>", "</p>" },
+};
+
+void writeDocument(
+    MarkupWriter &writer,
+    const Script &script,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  writer.write("<!DOCTYPE html>\n<html>\n<head>\n");
 
   if (!css_fn.empty()) {
     if (embed_css) {
-      std::string css_contents = file_get_contents(css_fn);
-      output += "<style type='text/css'>\n";
-      output += css_contents;
-      output += "\n</style>\n";
+      std::string css_contents = stylesheet_contents(css_fn);
+      writer.write("<style type='text/css'>\n");
+      writer.write(css_contents);
+      writer.write("\n</style>\n");
     } else {
-      output += R"(<link rel="stylesheet" type="text/css" href=")";
-      output += ((css_fn[0] == '/') ? "file://" : "") + css_fn;
-      output += "'>\n";
+      writer.write(R"(<link rel="stylesheet" type="text/css" href=")");
+      writer.write(((css_fn[0] == '/') ? "file://" : "") + css_fn);
+      writer.write("'>\n");
     }
   }
 
-  output +=
+  writer.write(
       "</head>\n<body>\n"
-      "<div id=\"wrapper\" class=\"fountain\">\n";
-
-  Fountain::Script script;
-  script.parseFountain(input);
+      "<div id=\"wrapper\" class=\"fountain\">\n"
+  );
 
-  output += script.to_string(
+  writer.write(
+      script,
       Fountain::ScriptNodeType::ftnContinuation | Fountain::ScriptNodeType::ftnKeyValue |
-      Fountain::ScriptNodeType::ftnUnknown
+          Fountain::ScriptNodeType::ftnUnknown
   );
 
-  output += "\n</div>\n</body>\n</html>\n";
-
-  try {
-    replace_all_inplace(output, "<Transition>", R"(<h3 class="right-transition">)");
-    replace_all_inplace(output, "</Transition>", "</h3>");
-
-    replace_all_inplace(output, "<SceneHeader>", R"(<h2 class="full-slugline">)");
-    replace_all_inplace(output, "</SceneHeader>", "</h2>");
-
-    replace_all_inplace(output, "<Action>", R"(<p class="action">)");
-    replace_all_inplace(output, "</Action>", "</p>");
-
-    replace_all_inplace(output, "<Lyric>", R"(<span class="lyric">)");
-    replace_all_inplace(output, "</Lyric>", "</span>");
-
-    replace_all_inplace(output, "<Character>", R"(<dt class="character">)");
-    replace_all_inplace(output, "</Character>", "</dt>");
-
-    replace_all_inplace(output, "<Parenthetical>", R"(<dd class="parenthetical">)");
-    replace_all_inplace(output, "</Parenthetical>", "</dd>");
-
-    replace_all_inplace(output, "<Speech>", R"(<dd class="dialogue">)");
-    replace_all_inplace(output, "</Speech>", "</dd>");
-
-    replace_all_inplace(output, "<Dialog>", R"(<div class="dialog">)");
-    replace_all_inplace(output, "</Dialog>", "</div>");
-
-    replace_all_inplace(output, "<DialogDual>", R"(<div class="dialog_wrapper">)");
-    replace_all_inplace(output, "</DialogDual>", "</div>");
-
-    replace_all_inplace(output, "<DialogLeft>", R"(<dl class="first">)");
-    replace_all_inplace(output, "</DialogLeft>", "</dl>");
-
-    replace_all_inplace(output, "<DialogRight>", R"(<dl class="second">)");
-    replace_all_inplace(output, "</DialogRight>", "</dl>");
-
-    replace_all_inplace(output, "</PageBreak>", R"(<div class="page-break">)");
-    replace_all_inplace(output, "</PageBreak>", "</div>");
-
-    replace_all_inplace(output, "<Note>", R"(<p class="comment">)");
-    replace_all_inplace(output, "</Note>", "</p>");
+  writer.write("\n</div>\n</body>\n</html>\n");
+}
 
-    replace_all_inplace(output, "<BlankLine>", "");
-    replace_all_inplace(output, "</BlankLine>", "");
+}  // namespace
 
-    replace_all_inplace(output, "<ActionCenter>", R"(<p class="center">)");
-    replace_all_inplace(output, "</ActionCenter>", "</p>");
+std::string ftn2textplay(
+    const std::string_view &input,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  return ftn2textplay(Script(input), css_fn, embed_css);
+}
 
-    static const std::regex re_newlines(R"(\n+)");
-    output = std::regex_replace(output, re_newlines, "\n");
-  } catch (std::regex_error &e) {
-    print_regex_error(e, __FILE__, __LINE__);
-  }
+void ftn2textplay(
+    std::ostream &out,
+    const std::string_view &input,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  ftn2textplay(out, Script(input), css_fn, embed_css);
+}
 
+std::string ftn2textplay(
+    const Script &script,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  std::string output;
+  MarkupWriter writer(output, textplay_tags);
+  writeDocument(writer, script, css_fn, embed_css);
   return output;
 }
 
+void ftn2textplay(
+    std::ostream &out,
+    const Script &script,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  MarkupWriter writer(out, textplay_tags);
+  writeDocument(writer, script, css_fn, embed_css);
+}
+
 }  // namespace Fountain
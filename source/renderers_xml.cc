@@ -3,53 +3,87 @@
 
 #include "renderers_xml.h"
 
-#include <regex>
+#include <ostream>
 #include <string>
+#include <string_view>
 
 #include "model_script.h"
 #include "parser_fountain.h"
-#include "utils_file.h"
-#include "utils_string.h"
+#include "renderers_markup.h"
 
 namespace Fountain {
 
-std::string
-ftn2xml(const std::string &input, const std::string &css_fn, const bool &embed_css) {
-  std::string output{ "<!DOCTYPE html>\n<html>\n<head>\n" };
+namespace {
+
+// intermediate tags are kept as is
+const TagTable xml_tags;
+
+void writeDocument(
+    MarkupWriter &writer,
+    const Script &script,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  writer.write("<!DOCTYPE html>\n<html>\n<head>\n");
 
   if (!css_fn.empty()) {
     if (embed_css) {
-      std::string css_contents = file_get_contents(css_fn);
-      output += "<style type='text/css'>\n";
-      output += css_contents;
-      output += "\n</style>\n";
+      std::string css_contents = stylesheet_contents(css_fn);
+      writer.write("<style type='text/css'>\n");
+      writer.write(css_contents);
+      writer.write("\n</style>\n");
     } else {
-      output += R"(<link rel="stylesheet" type="text/css" href=")";
-      output += ((css_fn[0] == '/') ? "file://" : "") + css_fn;
-      output += "'>\n";
+      writer.write(R"(<link rel="stylesheet" type="text/css" href=")");
+      writer.write(((css_fn[0] == '/') ? "file://" : "") + css_fn);
+      writer.write("'>\n");
     }
   }
 
-  output += "</head>\n<body>\n";
-
-  Fountain::Script script;
-  script.parseFountain(input);
+  writer.write("</head>\n<body>\n");
 
-  output += script.to_string(
+  writer.write(
+      script,
       Fountain::ScriptNodeType::ftnContinuation | Fountain::ScriptNodeType::ftnKeyValue |
-      Fountain::ScriptNodeType::ftnUnknown
+          Fountain::ScriptNodeType::ftnUnknown
   );
 
-  output += "\n</body>\n</html>\n";
+  writer.write("\n</body>\n</html>\n");
+}
 
-  try {
-    static const std::regex re_newlines(R"(\n+)");
-    output = std::regex_replace(output, re_newlines, "\n");
-  } catch (std::regex_error &e) {
-    print_regex_error(e, __FILE__, __LINE__);
-  }
+}  // namespace
 
+std::string ftn2xml(
+    const std::string_view &input,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  return ftn2xml(Script(input), css_fn, embed_css);
+}
+
+void ftn2xml(
+    std::ostream &out,
+    const std::string_view &input,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  ftn2xml(out, Script(input), css_fn, embed_css);
+}
+
+std::string ftn2xml(const Script &script, const std::string &css_fn, const bool &embed_css) {
+  std::string output;
+  MarkupWriter writer(output, xml_tags);
+  writeDocument(writer, script, css_fn, embed_css);
   return output;
 }
 
+void ftn2xml(
+    std::ostream &out,
+    const Script &script,
+    const std::string &css_fn,
+    const bool &embed_css
+) {
+  MarkupWriter writer(out, xml_tags);
+  writeDocument(writer, script, css_fn, embed_css);
+}
+
 }  // namespace Fountain
@@ -2,11 +2,37 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #pragma once
+#include <ostream>
 #include <string>
+#include <string_view>
+
+#include "model_script.h"
 
 namespace Fountain {
 std::string ftn2xml(
-    const std::string &input,
+    const std::string_view &input,
+    const std::string &css_fn = "fountain-xml.css",
+    const bool &embed_css = false
+);
+
+// Write the document to out as it is rendered.
+void ftn2xml(
+    std::ostream &out,
+    const std::string_view &input,
+    const std::string &css_fn = "fountain-xml.css",
+    const bool &embed_css = false
+);
+
+// Render a script that is already parsed.  A const Script may be rendered by several threads
+// at once.
+std::string ftn2xml(
+    const Script &script,
+    const std::string &css_fn = "fountain-xml.css",
+    const bool &embed_css = false
+);
+void ftn2xml(
+    std::ostream &out,
+    const Script &script,
     const std::string &css_fn = "fountain-xml.css",
     const bool &embed_css = false
 );
@@ -3,26 +3,136 @@
 
 #include "utils_file.h"
 
+#include <cerrno>
+#include <filesystem>
 #include <fstream>
-#include <iterator>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "utils_stats.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#  define FOUNTAIN_HAVE_MMAP
+#endif
+
+namespace {
+
+constexpr std::size_t read_block = 64 * 1024;
+
+#ifdef FOUNTAIN_HAVE_MMAP
+void read_fd(const int fd, std::string &buffer) {
+  std::size_t length = 0;
+  for (;;) {
+    buffer.resize(length + read_block);
+    const ssize_t count = read(fd, &buffer[length], read_block);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      break;
+    }
+    length += count;
+  }
+  buffer.resize(length);
+}
+#endif
+
+}  // namespace
+
+FileView::FileView(const std::string &filename) {
+  const Fountain::StatsTimer timer(Fountain::statRead);
+#ifdef FOUNTAIN_HAVE_MMAP
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  opened = true;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      madvise(addr, st.st_size, MADV_SEQUENTIAL);
+      mapping = addr;
+      data = static_cast<const char *>(addr);
+      length = st.st_size;
+      close(fd);
+      return;
+    }
+  }
+  read_fd(fd, buffer);
+  close(fd);
+#else
+  std::ifstream instream(filename, std::ios::in | std::ios::binary);
+  if (!instream) {
+    return;
+  }
+  opened = true;
+  std::size_t count = 0;
+  do {
+    buffer.resize(count + read_block);
+    count += instream.rdbuf()->sgetn(&buffer[count], read_block);
+  } while (count == buffer.length());
+  buffer.resize(count);
+#endif
+  data = buffer.data();
+  length = buffer.length();
+}
+
+FileView::~FileView() {
+#ifdef FOUNTAIN_HAVE_MMAP
+  if (mapping) {
+    munmap(mapping, length);
+  }
+#endif
+}
 
 std::string file_get_contents(const std::string &filename) {
   try {
-    std::ifstream instream(filename, std::ios::in);
-    std::string contents(
-        (std::istreambuf_iterator<char>(instream)), (std::istreambuf_iterator<char>())
-    );
-    instream.close();
-    return contents;
+    FileView file(filename);
+    return std::string(file.view());
   } catch (...) {
     return {};
   }
 }
 
+std::string file_get_cached(const std::string &filename) {
+  struct Entry {
+    std::filesystem::file_time_type time;
+    std::uintmax_t size;
+    std::string contents;
+  };
+  static std::mutex mutex;
+  static std::map<std::string, Entry> entries;
+
+  std::error_code ec;
+  const auto time = std::filesystem::last_write_time(filename, ec);
+  const std::uintmax_t size = ec ? 0 : std::filesystem::file_size(filename, ec);
+  if (ec) {
+    return file_get_contents(filename);
+  }
+  {
+    const std::lock_guard<std::mutex> lock(mutex);
+    const auto entry = entries.find(filename);
+    if (entry != entries.end() && entry->second.time == time && entry->second.size == size) {
+      return entry->second.contents;
+    }
+  }
+  std::string contents = file_get_contents(filename);
+  const std::lock_guard<std::mutex> lock(mutex);
+  entries[filename] = Entry{ time, size, contents };
+  return contents;
+}
+
 bool file_set_contents(const std::string &filename, const std::string &contents) {
   try {
     std::ofstream outstream(filename, std::ios::out);
-    std::copy(contents.begin(), contents.end(), std::ostream_iterator<char>(outstream));
+    outstream.write(contents.data(), contents.size());
     outstream.close();
     return true;
   } catch (...) {
@@ -32,12 +142,9 @@ bool file_set_contents(const std::string &filename, const std::string &contents)
 
 std::vector<std::uint8_t> file_get_data(const std::string &filename) {
   try {
-    std::ifstream instream(filename, std::ios::in | std::ios::binary);
-    std::vector<std::uint8_t> contents(
-        (std::istreambuf_iterator<char>(instream)), (std::istreambuf_iterator<char>())
-    );
-    instream.close();
-    return contents;
+    FileView file(filename);
+    const std::string_view contents = file.view();
+    return std::vector<std::uint8_t>(contents.begin(), contents.end());
   } catch (...) {
     return {};
   }
@@ -46,7 +153,7 @@ std::vector<std::uint8_t> file_get_data(const std::string &filename) {
 bool file_set_data(const std::string &filename, const std::vector<std::uint8_t> &contents) {
   try {
     std::ofstream outstream(filename, std::ios::out | std::ios::binary);
-    std::copy(contents.begin(), contents.end(), std::ostream_iterator<char>(outstream));
+    outstream.write(reinterpret_cast<const char *>(contents.data()), contents.size());
     outstream.close();
     return true;
   } catch (...) {
@@ -3,12 +3,44 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 std::string file_get_contents(const std::string &filename);
 bool file_set_contents(const std::string &filename, const std::string &contents);
 
+// Contents of a small file that is read often, such as a stylesheet.  The contents are kept
+// and read again only when the file's size or modification time changes.
+std::string file_get_cached(const std::string &filename);
+
 std::vector<std::uint8_t> file_get_data(const std::string &filename);
 bool file_set_data(const std::string &filename, const std::vector<std::uint8_t> &contents);
+
+// Read-only contents of a file.  Regular files are memory-mapped where supported.  Pipes and
+// devices such as /dev/stdin are read in large blocks.  The view is empty if the file cannot
+// be read; is_open() tells an unreadable file from an empty one.
+class FileView {
+ public:
+  explicit FileView(const std::string &filename);
+  ~FileView();
+
+  FileView(const FileView &) = delete;
+  FileView &operator=(const FileView &) = delete;
+
+  std::string_view view() const {
+    return { data, length };
+  }
+  bool is_open() const {
+    return opened;
+  }
+
+ private:
+  const char *data = nullptr;
+  std::size_t length = 0;
+  void *mapping = nullptr;
+  std::string buffer;  // contents when not mapped
+  bool opened = false;
+};
@@ -0,0 +1,226 @@
+// SPDX-FileCopyrightText: Copyright 2021-2025 xiota
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "utils_scan.h"
+
+#include <cstddef>
+#include <string_view>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#  include <immintrin.h>
+#  define FOUNTAIN_HAVE_X86_KERNELS
+#endif
+
+namespace {
+
+constexpr std::size_t max_set = 16;
+
+// Each kernel returns length rather than npos when nothing is found, so the vector loops can
+// finish with the scalar loop on the remaining bytes.
+struct Kernels {
+  std::size_t (*any)(const char *data, std::size_t length, const char *set, std::size_t count);
+  std::size_t (*whitespace)(const char *data, std::size_t length);
+  bool (*lowercase)(const char *data, std::size_t length);
+  const char *name;
+};
+
+bool isSpace(const unsigned char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+std::size_t anyScalar(
+    const char *data,
+    const std::size_t length,
+    const char *set,
+    const std::size_t count
+) {
+  for (std::size_t pos = 0; pos < length; ++pos) {
+    for (std::size_t i = 0; i < count; ++i) {
+      if (data[pos] == set[i]) {
+        return pos;
+      }
+    }
+  }
+  return length;
+}
+
+std::size_t whitespaceScalar(const char *data, const std::size_t length) {
+  std::size_t pos = 0;
+  while (pos < length && isSpace(data[pos])) {
+    ++pos;
+  }
+  return pos;
+}
+
+bool lowercaseScalar(const char *data, const std::size_t length) {
+  for (std::size_t pos = 0; pos < length; ++pos) {
+    if (data[pos] >= 'a' && data[pos] <= 'z') {
+      return true;
+    }
+  }
+  return false;
+}
+
+#ifdef FOUNTAIN_HAVE_X86_KERNELS
+// Unsigned bytes of a that are <= limit, as 0xff
+__attribute__((target("sse2"))) __m128i atMost(const __m128i a, const char limit) {
+  return _mm_cmpeq_epi8(_mm_min_epu8(a, _mm_set1_epi8(limit)), a);
+}
+
+__attribute__((target("sse2"))) std::size_t anySse2(
+    const char *data,
+    const std::size_t length,
+    const char *set,
+    const std::size_t count
+) {
+  __m128i needles[max_set];
+  for (std::size_t i = 0; i < count; ++i) {
+    needles[i] = _mm_set1_epi8(set[i]);
+  }
+  std::size_t pos = 0;
+  for (; pos + 16 <= length; pos += 16) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    __m128i hits = _mm_setzero_si128();
+    for (std::size_t i = 0; i < count; ++i) {
+      hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[i]));
+    }
+    if (const unsigned mask = _mm_movemask_epi8(hits)) {
+      return pos + __builtin_ctz(mask);
+    }
+  }
+  return pos + anyScalar(data + pos, length - pos, set, count);
+}
+
+__attribute__((target("sse2"))) std::size_t whitespaceSse2(
+    const char *data,
+    const std::size_t length
+) {
+  std::size_t pos = 0;
+  for (; pos + 16 <= length; pos += 16) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    const __m128i space = _mm_or_si128(
+        _mm_cmpeq_epi8(block, _mm_set1_epi8(' ')),
+        atMost(_mm_sub_epi8(block, _mm_set1_epi8('\t')), '\r' - '\t')
+    );
+    if (const unsigned mask = ~_mm_movemask_epi8(space) & 0xffff) {
+      return pos + __builtin_ctz(mask);
+    }
+  }
+  return pos + whitespaceScalar(data + pos, length - pos);
+}
+
+__attribute__((target("sse2"))) bool lowercaseSse2(const char *data, const std::size_t length) {
+  std::size_t pos = 0;
+  for (; pos + 16 <= length; pos += 16) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    const __m128i offset = _mm_sub_epi8(block, _mm_set1_epi8('a'));
+    if (_mm_movemask_epi8(atMost(offset, 'z' - 'a'))) {
+      return true;
+    }
+  }
+  return lowercaseScalar(data + pos, length - pos);
+}
+
+// The AVX2 kernels finish with the SSE2 ones, after clearing the upper halves of the vector
+// registers, which would otherwise slow every later SSE instruction.
+__attribute__((target("avx2"))) __m256i atMost256(const __m256i a, const char limit) {
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(a, _mm256_set1_epi8(limit)), a);
+}
+
+__attribute__((target("avx2"))) std::size_t anyAvx2(
+    const char *data,
+    const std::size_t length,
+    const char *set,
+    const std::size_t count
+) {
+  __m256i needles[max_set];
+  for (std::size_t i = 0; i < count; ++i) {
+    needles[i] = _mm256_set1_epi8(set[i]);
+  }
+  std::size_t pos = 0;
+  for (; pos + 32 <= length; pos += 32) {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+    __m256i hits = _mm256_setzero_si256();
+    for (std::size_t i = 0; i < count; ++i) {
+      hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, needles[i]));
+    }
+    if (const unsigned mask = _mm256_movemask_epi8(hits)) {
+      return pos + __builtin_ctz(mask);
+    }
+  }
+  _mm256_zeroupper();
+  return pos + anySse2(data + pos, length - pos, set, count);
+}
+
+__attribute__((target("avx2"))) std::size_t whitespaceAvx2(
+    const char *data,
+    const std::size_t length
+) {
+  std::size_t pos = 0;
+  for (; pos + 32 <= length; pos += 32) {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+    const __m256i space = _mm256_or_si256(
+        _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')),
+        atMost256(_mm256_sub_epi8(block, _mm256_set1_epi8('\t')), '\r' - '\t')
+    );
+    if (const unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(space))) {
+      return pos + __builtin_ctz(mask);
+    }
+  }
+  _mm256_zeroupper();
+  return pos + whitespaceSse2(data + pos, length - pos);
+}
+
+__attribute__((target("avx2"))) bool lowercaseAvx2(const char *data, const std::size_t length) {
+  std::size_t pos = 0;
+  for (; pos + 32 <= length; pos += 32) {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+    const __m256i offset = _mm256_sub_epi8(block, _mm256_set1_epi8('a'));
+    if (_mm256_movemask_epi8(atMost256(offset, 'z' - 'a'))) {
+      return true;
+    }
+  }
+  _mm256_zeroupper();
+  return lowercaseSse2(data + pos, length - pos);
+}
+#endif
+
+Kernels selectKernels() {
+#ifdef FOUNTAIN_HAVE_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return { anyAvx2, whitespaceAvx2, lowercaseAvx2, "avx2" };
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return { anySse2, whitespaceSse2, lowercaseSse2, "sse2" };
+  }
+#endif
+  return { anyScalar, whitespaceScalar, lowercaseScalar, "scalar" };
+}
+
+const Kernels &kernels() {
+  static const Kernels selected = selectKernels();
+  return selected;
+}
+
+}  // namespace
+
+std::size_t scan_any(const std::string_view &text, const std::string_view &set) {
+  if (set.length() > max_set) {
+    return text.find_first_of(set);
+  }
+  const std::size_t pos = kernels().any(text.data(), text.length(), set.data(), set.length());
+  return (pos < text.length()) ? pos : std::string_view::npos;
+}
+
+std::size_t scan_whitespace(const std::string_view &text) {
+  return kernels().whitespace(text.data(), text.length());
+}
+
+bool scan_lowercase(const std::string_view &text) {
+  return kernels().lowercase(text.data(), text.length());
+}
+
+const char *scan_kernels() {
+  return kernels().name;
+}
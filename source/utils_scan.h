@@ -0,0 +1,24 @@
+// SPDX-FileCopyrightText: Copyright 2021-2025 xiota
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// Byte scanning kernels for the parser's per-line loops.  Each runs 16 or 32 bytes at a time
+// with SSE2 or AVX2, chosen once for the running CPU, and falls back to a plain loop
+// elsewhere.  Only ASCII bytes are classified, so UTF-8 text is handled unchanged.
+
+// Offset of the first byte of text that is one of the bytes in set, or npos.  Sets of more
+// than 16 bytes are searched without vectors.
+std::size_t scan_any(const std::string_view &text, const std::string_view &set);
+
+// Number of whitespace bytes (FOUNTAIN_WHITESPACE) at the start of text
+std::size_t scan_whitespace(const std::string_view &text);
+
+// Whether text contains an ASCII lowercase letter
+bool scan_lowercase(const std::string_view &text);
+
+// Kernels in use: "avx2", "sse2" or "scalar"
+const char *scan_kernels();
@@ -0,0 +1,167 @@
+// SPDX-FileCopyrightText: Copyright 2021-2025 xiota
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "utils_stats.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "model_script.h"
+
+namespace Fountain {
+
+std::atomic<bool> stats_active{ false };
+
+namespace {
+
+constexpr const char *phase_names[stat_phases] = {
+  "read", "parse", "inline", "render", "pdf", "write",
+};
+constexpr const char *counter_names[stat_counters] = {
+  "bytes",
+  "lines",
+  "keyword_lookups",
+  "allocations",
+};
+
+// names of node types, by bit
+constexpr const char *node_names[] = {
+  "Unknown",        "Boneyard",      "Comment",       "KeyValue",    "Continuation",
+  "PageBreak",      "BlankLine",     "SceneHeader",   "Action",      "ActionCenter",
+  "Transition",     "Dialog",        "DialogLeft",    "DialogRight", "Character",
+  "Parenthetical",  "Speech",        "Notation",      "Lyric",       "Section",
+  "Synopsis",
+};
+constexpr std::size_t node_types = sizeof(node_names) / sizeof(node_names[0]);
+
+std::atomic<std::int64_t> phase_ns[stat_phases];
+std::atomic<std::uint64_t> counters[stat_counters];
+std::atomic<std::uint64_t> nodes[node_types];
+
+// innermost running timer on this thread
+thread_local StatsTimer *current_timer = nullptr;
+
+}  // namespace
+
+void stats_enable(const bool &enable) {
+  stats_active.store(enable, std::memory_order_relaxed);
+}
+
+void stats_reset() {
+  for (auto &ns : phase_ns) {
+    ns = 0;
+  }
+  for (auto &count : counters) {
+    count = 0;
+  }
+  for (auto &count : nodes) {
+    count = 0;
+  }
+}
+
+void stats_count(const StatsCounter &counter, const std::uint64_t &n) {
+  if (stats_enabled()) {
+    counters[counter].fetch_add(n, std::memory_order_relaxed);
+  }
+}
+
+void stats_count_nodes(const Script &script) {
+  if (!stats_enabled()) {
+    return;
+  }
+  std::uint64_t counts[node_types] = {};
+  for (const auto &node : script.nodes) {
+    for (std::size_t bit = 0; bit < node_types; ++bit) {
+      if (node.type == (1ull << bit)) {
+        ++counts[bit];
+        break;
+      }
+    }
+  }
+  for (std::size_t bit = 0; bit < node_types; ++bit) {
+    if (counts[bit]) {
+      nodes[bit].fetch_add(counts[bit], std::memory_order_relaxed);
+    }
+  }
+}
+
+std::string stats_report(const bool &json) {
+  std::string output;
+  auto group = [&](const char *name) {
+    if (json) {
+      output += output.empty() ? "{\"" : "}, \"";
+      output += name;
+      output += "\": {";
+    } else {
+      output += name;
+      output += '\n';
+    }
+  };
+  bool first = true;
+  auto entry = [&](const char *name, const char *format, auto value) {
+    char text[64];
+    std::snprintf(text, sizeof(text), format, value);
+    if (json) {
+      output += first ? "\"" : ", \"";
+      output += name;
+      output += "\": ";
+      output += text;
+    } else {
+      char line[128];
+      std::snprintf(line, sizeof(line), "  %-14s %s\n", name, text);
+      output += line;
+    }
+    first = false;
+  };
+
+  group("phases");
+  double total = 0;
+  for (std::size_t i = 0; i < stat_phases; ++i) {
+    total += phase_ns[i].load() / 1e9;
+    entry(phase_names[i], "%.6f", phase_ns[i].load() / 1e9);
+  }
+  entry("total", "%.6f", total);
+
+  group("counters");
+  first = true;
+  for (std::size_t i = 0; i < stat_counters; ++i) {
+    entry(counter_names[i], "%llu", static_cast<unsigned long long>(counters[i].load()));
+  }
+
+  group("nodes");
+  first = true;
+  for (std::size_t i = 0; i < node_types; ++i) {
+    if (const std::uint64_t count = nodes[i].load()) {
+      entry(node_names[i], "%llu", static_cast<unsigned long long>(count));
+    }
+  }
+  output += json ? "}}\n" : "";
+  return output;
+}
+
+void StatsTimer::begin() {
+  start = std::chrono::steady_clock::now();
+  parent = current_timer;
+  if (parent) {
+    parent->elapsed += start - parent->start;
+  }
+  current_timer = this;
+}
+
+void StatsTimer::end() {
+  const auto stop = std::chrono::steady_clock::now();
+  elapsed += stop - start;
+  phase_ns[phase].fetch_add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+      std::memory_order_relaxed
+  );
+  current_timer = parent;
+  if (parent) {
+    parent->start = stop;
+  }
+}
+
+}  // namespace Fountain
@@ -0,0 +1,79 @@
+// SPDX-FileCopyrightText: Copyright 2021-2025 xiota
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "model_script.h"
+
+namespace Fountain {
+
+// Phases of a conversion.  Each phase counts only time not spent in a nested phase, so the
+// phases add up to the instrumented total.  Time on several threads is summed.
+enum StatsPhase {
+  statRead,     // mapping or reading input
+  statParse,    // preprocessing and classifying lines
+  statInline,   // emphasis and notes within nodes
+  statRender,   // rendering nodes and translating tags
+  statPdf,      // laying out and painting PDF pages
+  statWrite,    // writing output
+  stat_phases,
+};
+
+enum StatsCounter {
+  statBytes,        // input bytes parsed
+  statLines,        // lines classified
+  statLookups,      // transition and scene heading keyword lookups
+  statAllocations,  // counted only where operator new reports them
+  stat_counters,
+};
+
+// Statistics are recorded only while enabled.  A disabled probe costs one relaxed load.
+extern std::atomic<bool> stats_active;
+
+inline bool stats_enabled() {
+  return stats_active.load(std::memory_order_relaxed);
+}
+
+void stats_enable(const bool &enable = true);
+void stats_reset();
+
+void stats_count(const StatsCounter &counter, const std::uint64_t &n = 1);
+void stats_count_nodes(const Script &script);
+
+// Breakdown of phases, counters and nodes by type, as text or as JSON.
+std::string stats_report(const bool &json = false);
+
+// Adds the time from construction to destruction to a phase.
+class StatsTimer {
+ public:
+  explicit StatsTimer(const StatsPhase &phase) : phase(phase), active(stats_enabled()) {
+    if (active) {
+      begin();
+    }
+  }
+  ~StatsTimer() {
+    if (active) {
+      end();
+    }
+  }
+
+  StatsTimer(const StatsTimer &) = delete;
+  StatsTimer &operator=(const StatsTimer &) = delete;
+
+ private:
+  void begin();
+  void end();
+
+  StatsPhase phase;
+  bool active;
+  StatsTimer *parent = nullptr;
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::duration elapsed{};
+};
+
+}  // namespace Fountain
@@ -0,0 +1,28 @@
+// SPDX-FileCopyrightText: Copyright 2021-2025 xiota
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Global allocation functions that count allocations for --stats.  They are linked into the
+// CLI only, so programs using the library keep their own.
+
+#include <cstdlib>
+#include <new>
+
+#include "utils_stats.h"
+
+void *operator new(std::size_t size) {
+  if (Fountain::stats_enabled()) {
+    Fountain::stats_count(Fountain::statAllocations);
+  }
+  if (void *ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
@@ -9,6 +9,8 @@
 #include <iterator>
 #include <sstream>
 
+#include "utils_scan.h"
+
 std::string &ltrim_inplace(std::string &s, const char *t) {
   s.erase(0, s.find_first_not_of(t));
   return s;
@@ -37,7 +39,8 @@ std::string &replace_all_inplace(
 }
 
 std::string ws_ltrim(std::string s) {
-  return ltrim_inplace(s, FOUNTAIN_WHITESPACE);
+  s.erase(0, scan_whitespace(s));
+  return s;
 }
 
 std::string ws_rtrim(std::string s) {
@@ -45,7 +48,21 @@ std::string ws_rtrim(std::string s) {
 }
 
 std::string ws_trim(std::string s) {
-  return trim_inplace(s, FOUNTAIN_WHITESPACE);
+  rtrim_inplace(s, FOUNTAIN_WHITESPACE);
+  s.erase(0, scan_whitespace(s));
+  return s;
+}
+
+std::string_view ws_ltrim_view(const std::string_view &s) {
+  return s.substr(scan_whitespace(s));
+}
+
+std::string_view ws_rtrim_view(const std::string_view &s) {
+  return s.substr(0, s.find_last_not_of(FOUNTAIN_WHITESPACE) + 1);
+}
+
+std::string_view ws_trim_view(const std::string_view &s) {
+  return ws_ltrim_view(ws_rtrim_view(s));
 }
 
 std::string replace_all(
@@ -56,8 +73,8 @@ std::string replace_all(
   return replace_all_inplace(subject, search, replace);
 }
 
-bool begins_with(const std::string &input, const std::string &match) {
-  return !std::strncmp(input.c_str(), match.c_str(), match.length());
+bool begins_with(const std::string_view &input, const std::string_view &match) {
+  return input.substr(0, match.length()) == match;
 }
 
 std::vector<std::string>
@@ -100,44 +117,65 @@ std::string to_lower(std::string s) {
 }
 
 bool is_upper(const std::string_view &s) {
-  return std::all_of(s.begin(), s.end(), [](unsigned char c) { return !std::islower(c); });
+  return !scan_lowercase(s);
 }
 
-struct HtmlEntities {
-  std::string entity;
-  std::string value;
+namespace {
+
+// Characters that have entities.  Each entity is "&#NN;", with NN the decimal character code.
+constexpr char entity_chars[] = "&*_:[]\\<>.";
+constexpr std::size_t entity_length = 5;
+
+struct EntityTable {
+  bool has_entity[256] = {};
+
+  constexpr EntityTable() {
+    for (const char *c = entity_chars; *c; ++c) {
+      has_entity[static_cast<unsigned char>(*c)] = true;
+    }
+  }
 };
+constexpr EntityTable entity_table;
 
-static HtmlEntities entities[] = { { "&#38;", "&" },  { "&#42;", "*" }, { "&#95;", "_" },
-                                   { "&#58;", ":" },  { "&#91;", "[" }, { "&#93;", "]" },
-                                   { "&#92;", "\\" }, { "&#60;", "<" }, { "&#62;", ">" },
-                                   { "&#46;", "." } };
+// The character encoded by the entity at the start of text, or 0 if there is none.
+char entityValue(const std::string_view &text) {
+  if (text.length() < entity_length || text[1] != '#' || text[4] != ';' || text[2] < '0' ||
+      text[2] > '9' || text[3] < '0' || text[3] > '9') {
+    return 0;
+  }
+  const char c = static_cast<char>((text[2] - '0') * 10 + (text[3] - '0'));
+  return entity_table.has_entity[static_cast<unsigned char>(c)] ? c : 0;
+}
+
+}  // namespace
 
 std::string &encode_entities_inplace(std::string &input, bool bProcessAllEntities) {
-  for (std::size_t pos = 0; pos < input.length();) {
-    switch (input[pos]) {
-      case '&':
-        input.replace(pos, 1, "&#38;");
-        pos += 5;
-        break;
-      case '<':
-        input.replace(pos, 1, "&#60;");
-        pos += 5;
-        break;
-      default:
-        if (bProcessAllEntities) {
-          for (auto e : entities) {
-            if (e.value == input.substr(pos, 1)) {
-              input.replace(pos, e.value.length(), e.entity);
-              pos += e.entity.length() - 1;
-              break;
-            }
-          }
-        }
-        ++pos;
-        break;
+  const std::string_view special = bProcessAllEntities ? entity_chars : "&<";
+  const std::string_view text = input;
+  std::size_t count = 0;
+  for (std::size_t pos = scan_any(text, special); pos != std::string::npos; ++count) {
+    const std::size_t next = scan_any(text.substr(pos + 1), special);
+    pos = (next == std::string::npos) ? next : pos + 1 + next;
+  }
+  if (count == 0) {
+    return input;
+  }
+
+  // each character becomes an entity of the same length
+  std::string output;
+  output.reserve(input.length() + count * (entity_length - 1));
+  for (std::size_t pos = 0; pos < text.length();) {
+    const std::size_t next = scan_any(text.substr(pos), special);
+    const std::size_t end = (next == std::string::npos) ? text.length() : pos + next;
+    output.append(text, pos, end - pos);
+    if (end < text.length()) {
+      const unsigned char c = text[end];
+      const char entity[] = { '&', '#', char('0' + c / 10), char('0' + c % 10), ';' };
+      output.append(entity, entity_length);
     }
+    pos = end + 1;
   }
+  input.swap(output);
   return input;
 }
 
@@ -146,27 +184,27 @@ std::string encode_entities(std::string input, bool bProcessAllEntities) {
 }
 
 std::string &decode_entities_inplace(std::string &input) {
-  for (std::size_t pos = 0; pos < input.length();) {
-    switch (input[pos]) {
-      case '&': {
-        std::size_t end;
-        if ((end = input.find(';', pos)) != std::string::npos) {
-          std::string substr = input.substr(pos, end - pos + 1);
-          for (auto e : entities) {
-            if (substr == e.entity) {
-              input.replace(pos, substr.length(), e.value);
-              pos += e.value.length() - 1;
-              break;
-            }
-          }
-        }
-        ++pos;
-      } break;
-      default:
-        ++pos;
-        break;
+  // entities are longer than the characters they encode, so text is moved down in place
+  std::size_t read = input.find('&');
+  if (read == std::string::npos) {
+    return input;
+  }
+  std::size_t write = read;
+  while (read < input.length()) {
+    if (const char c = entityValue(std::string_view(input).substr(read, entity_length))) {
+      input[write++] = c;
+      read += entity_length;
+      continue;
+    }
+    std::size_t next = input.find('&', read + 1);
+    if (next == std::string::npos) {
+      next = input.length();
     }
+    std::memmove(&input[write], &input[read], next - read);
+    write += next - read;
+    read = next;
   }
+  input.resize(write);
   return input;
 }
 
@@ -174,6 +212,53 @@ std::string decode_entities(std::string input) {
   return decode_entities_inplace(input);
 }
 
+std::uint64_t hash_bytes(const std::string_view &data, const std::uint64_t &seed) {
+  constexpr std::uint64_t m = 0xc6a4a7935bd1e995ull;
+  constexpr int r = 47;
+
+  std::uint64_t h = seed ^ (data.length() * m);
+  const std::size_t blocks = data.length() / 8;
+  for (std::size_t i = 0; i < blocks; ++i) {
+    std::uint64_t k;
+    std::memcpy(&k, data.data() + i * 8, sizeof(k));
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    h ^= k;
+    h *= m;
+  }
+
+  const unsigned char *tail = reinterpret_cast<const unsigned char *>(data.data()) + blocks * 8;
+  switch (data.length() & 7) {
+    case 7:
+      h ^= std::uint64_t(tail[6]) << 48;
+      [[fallthrough]];
+    case 6:
+      h ^= std::uint64_t(tail[5]) << 40;
+      [[fallthrough]];
+    case 5:
+      h ^= std::uint64_t(tail[4]) << 32;
+      [[fallthrough]];
+    case 4:
+      h ^= std::uint64_t(tail[3]) << 24;
+      [[fallthrough]];
+    case 3:
+      h ^= std::uint64_t(tail[2]) << 16;
+      [[fallthrough]];
+    case 2:
+      h ^= std::uint64_t(tail[1]) << 8;
+      [[fallthrough]];
+    case 1:
+      h ^= std::uint64_t(tail[0]);
+      h *= m;
+  }
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+  return h;
+}
+
 std::string cstr_assign(char *input) {
   if (input) {
     std::string output{ input };
@@ -33,8 +33,13 @@ std::string ws_ltrim(std::string s);
 std::string ws_rtrim(std::string s);
 std::string ws_trim(std::string s);
 
+// Whitespace trim without copying
+std::string_view ws_ltrim_view(const std::string_view &s);
+std::string_view ws_rtrim_view(const std::string_view &s);
+std::string_view ws_trim_view(const std::string_view &s);
+
 // String tests
-bool begins_with(const std::string &input, const std::string &match);
+bool begins_with(const std::string_view &input, const std::string_view &match);
 
 // Split
 std::vector<std::string>
@@ -54,6 +59,9 @@ std::string encode_entities(std::string input, bool bProcessAllEntities = false)
 std::string &decode_entities_inplace(std::string &input);
 std::string decode_entities(std::string input);
 
+// Fast non-cryptographic hash (MurmurHash64A).  Results depend on byte order.
+std::uint64_t hash_bytes(const std::string_view &data, const std::uint64_t &seed = 0);
+
 // C-string helpers
 std::string cstr_assign(char *input);
 std::vector<std::string> cstrv_assign(char **input);
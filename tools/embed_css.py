@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: Copyright 2021-2025 xiota
+# SPDX-License-Identifier: GPL-3.0-or-later
+
+"""Writes a C++ header holding stylesheets as constant data.
+
+Usage: embed_css.py OUTPUT CSS...
+
+Each stylesheet is listed with its file name and the output type it belongs to, which is
+the file name without ".css" and a leading "fountain-".
+"""
+
+import os
+import sys
+
+
+def main():
+    output, inputs = sys.argv[1], sys.argv[2:]
+    lines = [
+        "// Generated by tools/embed_css.py from the stylesheets in data/.  Do not edit.",
+        "",
+        "#pragma once",
+        "",
+        "#include <string_view>",
+        "",
+        "namespace Fountain::bundled {",
+        "",
+    ]
+    entries = []
+    for index, path in enumerate(inputs):
+        name = os.path.basename(path)
+        kind = name[: -len(".css")] if name.endswith(".css") else name
+        kind = kind[len("fountain-") :] if kind.startswith("fountain-") else kind
+        with open(path, "rb") as css:
+            data = css.read()
+        lines.append(f"inline constexpr char css_{index}[] =")
+        for pos in range(0, len(data), 20):
+            chunk = "".join(f"\\x{b:02x}" for b in data[pos : pos + 20])
+            lines.append(f'    "{chunk}"')
+        lines[-1] += ";"
+        lines.append("")
+        entries.append(f'  {{ "{kind}", "{name}", {{ css_{index}, {len(data)} }} }},')
+
+    lines += [
+        "struct Stylesheet {",
+        "  std::string_view type;",
+        "  std::string_view name;",
+        "  std::string_view contents;",
+        "};",
+        "",
+        "inline constexpr Stylesheet stylesheets[] = {",
+        *entries,
+        "};",
+        "",
+        "}  // namespace Fountain::bundled",
+        "",
+    ]
+    with open(output, "w", encoding="utf-8") as header:
+        header.write("\n".join(lines))
+
+
+if __name__ == "__main__":
+    main()